@@ -21,6 +21,7 @@
  * 02110-1301 USA
  */
 #include <stdio.h>
+#include <inttypes.h>
 #include <libubox/blobmsg.h>
 #include <libubox/blobmsg_json.h>
 #include <libubox/uloop.h>
@@ -33,257 +34,546 @@
 
 #define DSL_OBJECT_LINE "line"
 #define DSL_OBJECT_CHANNEL "channel"
+#define DSL_SNAPSHOT_AGE "snapshot_age"
+#define DSL_GENERATION "generation"
+
+struct dslmngr_config dslmngr_conf = {
+	.cache_ttl = 1000,
+	.workers = -1,
+	.history_period = 60,
+	.history_file = "/var/run/dslmngr.history",
+};
+
+struct dslmngr_startup dslmngr_startup;
 
 struct value2text {
 	int value;
 	char *text;
 };
 
+enum {
+	DSL_STATUS_SINCE,
+	DSL_STATUS_FIELDS,
+	DSL_STATUS_FORMAT,
+	__DSL_STATUS_MAX,
+};
+
+static const struct blobmsg_policy dsl_status_policy[__DSL_STATUS_MAX] = {
+	[DSL_STATUS_SINCE] = { .name = "since", .type = BLOBMSG_TYPE_INT32 },
+	[DSL_STATUS_FIELDS] = { .name = "fields", .type = BLOBMSG_TYPE_ARRAY },
+	[DSL_STATUS_FORMAT] = { .name = "format", .type = BLOBMSG_TYPE_STRING },
+};
+
+/* Names of all fields of the status and stats replies which can be selected, sorted */
+static const char * const dsl_field_names[] = {
+	"act_ra_mode", "act_snr_mode", "actinp", "actinprein", "actndr",
+	"actual_interleaving_delay", "allowed_profiles", "attenuation", "curr_rate",
+	"current_day_start", "current_profile", "currentday", "errored_secs", "errored_secs_64",
+	"firmware_version", "inpreport", "intlvblock", "intlvdepth", "last_showtime_start",
+	"last_state_transmitted", "lastshowtime", "line_encoding", "line_number",
+	"link_encapsulation_supported", "link_encapsulation_used", "link_status", "lpath", "lsymb",
+	"max_bit_rate", "nfec", "noise_margin", "power", "power_management_state",
+	"quarter_hour_start", "quarterhour", "rfec", "rxthrsh_ds", "severely_errored_secs",
+	"severely_errored_secs_64", "showtime", "showtime_start", "snr_mpb_ds", "snr_mpb_us",
+	"snr_mroc_us", "standard_used", "standards_supported", "status", "success_failure_cause",
+	"total", "total_start", "trellis", "upbokler_pb", "upstream", "us0_mask", "xtse",
+	"xtse_used", "xtuc_ansi_rev", "xtuc_ansi_std", "xtuc_country", "xtuc_crc_errors",
+	"xtuc_crc_errors_64", "xtuc_fec_errors", "xtuc_fec_errors_64", "xtuc_hec_errors",
+	"xtuc_hec_errors_64", "xtuc_vendor", "xtur_ansi_rev", "xtur_ansi_std", "xtur_country",
+	"xtur_crc_errors", "xtur_crc_errors_64", "xtur_fec_errors", "xtur_fec_errors_64",
+	"xtur_hec_errors", "xtur_hec_errors_64", "xtur_vendor"
+};
+
+/* Enough bits for all dsl_field_names */
+#define DSL_FIELD_MASK_WORDS 4
+
+/**
+ * struct dsl_field_mask - Fields selected by the "fields" argument of a request
+ *
+ * Bit i is set if dsl_field_names[i] is selected. all is true if there is no selection.
+ */
+struct dsl_field_mask {
+	bool all;
+	uint32_t bits[DSL_FIELD_MASK_WORDS];
+};
+
 enum {
 	DSL_STATS_INTERVAL,
+	DSL_STATS_SINCE,
+	DSL_STATS_FIELDS,
+	DSL_STATS_FORMAT,
 	__DSL_STATS_MAX,
 };
 
 static const struct blobmsg_policy dsl_stats_policy[__DSL_STATS_MAX] = {
 	[DSL_STATS_INTERVAL] = { .name = "interval", .type = BLOBMSG_TYPE_STRING },
+	[DSL_STATS_SINCE] = { .name = "since", .type = BLOBMSG_TYPE_INT32 },
+	[DSL_STATS_FIELDS] = { .name = "fields", .type = BLOBMSG_TYPE_ARRAY },
+	[DSL_STATS_FORMAT] = { .name = "format", .type = BLOBMSG_TYPE_STRING },
+};
+
+enum {
+	DSL_HISTORY_FIELD,
+	DSL_HISTORY_START,
+	DSL_HISTORY_END,
+	__DSL_HISTORY_MAX,
+};
+
+static const struct blobmsg_policy dsl_history_policy[__DSL_HISTORY_MAX] = {
+	[DSL_HISTORY_FIELD] = { .name = "field", .type = BLOBMSG_TYPE_STRING },
+	[DSL_HISTORY_START] = { .name = "start", .type = BLOBMSG_TYPE_INT32 },
+	[DSL_HISTORY_END] = { .name = "end", .type = BLOBMSG_TYPE_INT32 },
+};
+
+enum {
+	DSL_TONES_ARG_TYPE,
+	DSL_TONES_ARG_DIRECTION,
+	DSL_TONES_ARG_START,
+	DSL_TONES_ARG_END,
+	DSL_TONES_ARG_ENCODING,
+	__DSL_TONES_ARG_MAX,
+};
+
+static const struct blobmsg_policy dsl_tones_policy[__DSL_TONES_ARG_MAX] = {
+	[DSL_TONES_ARG_TYPE] = { .name = "type", .type = BLOBMSG_TYPE_STRING },
+	[DSL_TONES_ARG_DIRECTION] = { .name = "direction", .type = BLOBMSG_TYPE_STRING },
+	[DSL_TONES_ARG_START] = { .name = "start", .type = BLOBMSG_TYPE_INT32 },
+	[DSL_TONES_ARG_END] = { .name = "end", .type = BLOBMSG_TYPE_INT32 },
+	[DSL_TONES_ARG_ENCODING] = { .name = "encoding", .type = BLOBMSG_TYPE_STRING },
 };
 
-static const char *dsl_if_status_str(enum dsl_if_status status)
-{
-	switch (status) {
-	case IF_UP: return "up";
-	case IF_DOWN: return "down";
-	case IF_DORMANT: return "dormant";
-	case IF_NOTPRESENT: return "not_present";
-	case IF_LLDOWN: return "lower_layer_down";
-	case IF_ERROR: return "error";
-	case IF_UNKNOWN:
-	default: return "unknown";
-	}
-}
-
-static const char *dsl_link_status_str(enum dsl_link_status status)
-{
-	switch (status) {
-	case LINK_UP: return "up";
-	case LINK_INITIALIZING: return "initializing";
-	case LINK_ESTABLISHING: return "establishing";
-	case LINK_NOSIGNAL: return "no_signal";
-	case LINK_DISABLED: return "disabled";
-	case LINK_ERROR: return "error";
-	default: return "unknown";
-	}
-}
-
-static const char *dsl_mod_str(enum dsl_modtype mod)
-{
-	switch (mod) {
-	case MOD_G_922_1_ANNEX_A: return "gdmt_annexa";
-	case MOD_G_922_1_ANNEX_B: return "gdmt_annexb";
-	case MOD_G_922_1_ANNEX_C: return "gdmt_annexc";
-	case MOD_T1_413: return "t1413";
-	case MOD_T1_413i2: return "t1413_i2";
-	case MOD_ETSI_101_388: return "etsi_101_388";
-	case MOD_G_992_2: return "glite";
-	case MOD_G_992_3_Annex_A: return "adsl2_annexa";
-	case MOD_G_992_3_Annex_B: return "adsl2_annexb";
-	case MOD_G_992_3_Annex_C: return "adsl2_annexc";
-	case MOD_G_992_3_Annex_I: return "adsl2_annexi";
-	case MOD_G_992_3_Annex_J: return "adsl2_annexj";
-	case MOD_G_992_3_Annex_L: return "adsl2_annexl";
-	case MOD_G_992_3_Annex_M: return "adsl2_annexm";
-	case MOD_G_992_4: return "splitterless_adsl2";
-	case MOD_G_992_5_Annex_A: return "adsl2p_annexa";
-	case MOD_G_992_5_Annex_B: return "adsl2p_annexb";
-	case MOD_G_992_5_Annex_C: return "adsl2p_annexc";
-	case MOD_G_992_5_Annex_I: return "adsl2p_annexi";
-	case MOD_G_992_5_Annex_J: return "adsl2p_annexj";
-	case MOD_G_992_5_Annex_M: return "adsl2p_annexm";
-	case MOD_G_993_1: return "vdsl";
-	case MOD_G_993_1_Annex_A: return "vdsl_annexa";
-	case MOD_G_993_2_Annex_A: return "vdsl2_annexa";
-	case MOD_G_993_2_Annex_B: return "vdsl2_annexb";
-	case MOD_G_993_2_Annex_C: return "vdsl2_annexc";
-	default: return "unknown";
-	}
-}
-
-static const char *dsl_xtse_str(enum dsl_xtse_bit xtse)
-{
-	switch (xtse) {
+/* The tables of the enumerations are indexed by value, those of the bitmaps by bit number */
+static const char * const dsl_if_status_strs[] = {
+	[IF_UP] = "up",
+	[IF_DOWN] = "down",
+	[IF_UNKNOWN] = "unknown",
+	[IF_DORMANT] = "dormant",
+	[IF_NOTPRESENT] = "not_present",
+	[IF_LLDOWN] = "lower_layer_down",
+	[IF_ERROR] = "error",
+};
+
+static const char * const dsl_link_status_strs[] = {
+	[LINK_UP] = "up",
+	[LINK_INITIALIZING] = "initializing",
+	[LINK_ESTABLISHING] = "establishing",
+	[LINK_NOSIGNAL] = "no_signal",
+	[LINK_DISABLED] = "disabled",
+	[LINK_ERROR] = "error",
+};
+
+static const char * const dsl_mod_strs[] = {
+	"gdmt_annexa",		// MOD_G_922_1_ANNEX_A
+	"gdmt_annexb",		// MOD_G_922_1_ANNEX_B
+	"gdmt_annexc",		// MOD_G_922_1_ANNEX_C
+	"t1413",		// MOD_T1_413
+	"t1413_i2",		// MOD_T1_413i2
+	"etsi_101_388",		// MOD_ETSI_101_388
+	"glite",		// MOD_G_992_2
+	"adsl2_annexa",		// MOD_G_992_3_Annex_A
+	"adsl2_annexb",		// MOD_G_992_3_Annex_B
+	"adsl2_annexc",		// MOD_G_992_3_Annex_C
+	"adsl2_annexi",		// MOD_G_992_3_Annex_I
+	"adsl2_annexj",		// MOD_G_992_3_Annex_J
+	"adsl2_annexl",		// MOD_G_992_3_Annex_L
+	"adsl2_annexm",		// MOD_G_992_3_Annex_M
+	"splitterless_adsl2",	// MOD_G_992_4
+	"adsl2p_annexa",	// MOD_G_992_5_Annex_A
+	"adsl2p_annexb",	// MOD_G_992_5_Annex_B
+	"adsl2p_annexc",	// MOD_G_992_5_Annex_C
+	"adsl2p_annexi",	// MOD_G_992_5_Annex_I
+	"adsl2p_annexj",	// MOD_G_992_5_Annex_J
+	"adsl2p_annexm",	// MOD_G_992_5_Annex_M
+	"vdsl",			// MOD_G_993_1
+	"vdsl_annexa",		// MOD_G_993_1_Annex_A
+	"vdsl2_annexa",		// MOD_G_993_2_Annex_A
+	"vdsl2_annexb",		// MOD_G_993_2_Annex_B
+	"vdsl2_annexc",		// MOD_G_993_2_Annex_C
+};
+
+/* All DSL modes, MOD_G_922_1_ANNEX_A to MOD_G_993_2_Annex_C */
+#define DSL_MOD_ALL (((unsigned long)MOD_G_993_2_Annex_C << 1) - 1)
+
+/* The DSL mode of each XTSE bit, 0 for the reserved bits */
+static const unsigned long dsl_xtse_mods[] = {
 	/* Octet 1 - ADSL, i.e. g.dmt */
-	case T1_413: return dsl_mod_str(MOD_T1_413);
-	case ETSI_101_388: return dsl_mod_str(MOD_ETSI_101_388);
-	case G_992_1_POTS_NON_OVERLAPPED: return dsl_mod_str(MOD_G_922_1_ANNEX_A);
-	case G_992_1_POTS_OVERLAPPED: return dsl_mod_str(MOD_G_922_1_ANNEX_A);
-	case G_992_1_ISDN_NON_OVERLAPPED: return dsl_mod_str(MOD_G_922_1_ANNEX_B);
-	case G_992_1_ISDN_OVERLAPPED: return dsl_mod_str(MOD_G_922_1_ANNEX_B);
-	case G_992_1_TCM_ISDN_NON_OVERLAPPED: return dsl_mod_str(MOD_G_922_1_ANNEX_C);
-	case G_992_1_TCM_ISDN_OVERLAPPED: return dsl_mod_str(MOD_G_922_1_ANNEX_C);
+	[T1_413] = MOD_T1_413,
+	[ETSI_101_388] = MOD_ETSI_101_388,
+	[G_992_1_POTS_NON_OVERLAPPED] = MOD_G_922_1_ANNEX_A,
+	[G_992_1_POTS_OVERLAPPED] = MOD_G_922_1_ANNEX_A,
+	[G_992_1_ISDN_NON_OVERLAPPED] = MOD_G_922_1_ANNEX_B,
+	[G_992_1_ISDN_OVERLAPPED] = MOD_G_922_1_ANNEX_B,
+	[G_992_1_TCM_ISDN_NON_OVERLAPPED] = MOD_G_922_1_ANNEX_C,
+	[G_992_1_TCM_ISDN_OVERLAPPED] = MOD_G_922_1_ANNEX_C,
 
 	/* Octet 2 - Splitter-less ADSL, i.e. g.lite */
-	case G_992_2_POTS_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_2);
-	case G_992_2_POTS_OVERLAPPED: return dsl_mod_str(MOD_G_992_2);
-	case G_992_2_TCM_ISDN_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_2);
-	case G_992_2_TCM_ISDN_OVERLAPPED: return dsl_mod_str(MOD_G_992_2);
+	[G_992_2_POTS_NON_OVERLAPPED] = MOD_G_992_2,
+	[G_992_2_POTS_OVERLAPPED] = MOD_G_992_2,
+	[G_992_2_TCM_ISDN_NON_OVERLAPPED] = MOD_G_992_2,
+	[G_992_2_TCM_ISDN_OVERLAPPED] = MOD_G_992_2,
 	/* Bits 13 - 16 are reserved */
 
 	/* Octet 3 - ADSL2 */
 	/* Bits 17 - 18 are reserved */
-	case G_992_3_POTS_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_A);
-	case G_992_3_POTS_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_A);
-	case G_992_3_ISDN_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_B);
-	case G_992_3_ISDN_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_B);
-	case G_992_3_TCM_ISDN_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_C);
-	case G_992_3_TCM_ISDN_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_C);
+	[G_992_3_POTS_NON_OVERLAPPED] = MOD_G_992_3_Annex_A,
+	[G_992_3_POTS_OVERLAPPED] = MOD_G_992_3_Annex_A,
+	[G_992_3_ISDN_NON_OVERLAPPED] = MOD_G_992_3_Annex_B,
+	[G_992_3_ISDN_OVERLAPPED] = MOD_G_992_3_Annex_B,
+	[G_992_3_TCM_ISDN_NON_OVERLAPPED] = MOD_G_992_3_Annex_C,
+	[G_992_3_TCM_ISDN_OVERLAPPED] = MOD_G_992_3_Annex_C,
 
 	/* Octet 4 - Splitter-less ADSL2 and ADSL2 */
-	case G_992_4_POTS_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_4);
-	case G_992_4_POTS_OVERLAPPED: return dsl_mod_str(MOD_G_992_4);
+	[G_992_4_POTS_NON_OVERLAPPED] = MOD_G_992_4,
+	[G_992_4_POTS_OVERLAPPED] = MOD_G_992_4,
 	/* Bits 27 - 28 are reserved */
-	case G_992_3_ANNEX_I_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_I);
-	case G_992_3_ANNEX_I_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_I);
-	case G_992_3_ANNEX_J_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_J);
-	case G_992_3_ANNEX_J_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_J);
-
+	[G_992_3_ANNEX_I_NON_OVERLAPPED] = MOD_G_992_3_Annex_I,
+	[G_992_3_ANNEX_I_OVERLAPPED] = MOD_G_992_3_Annex_I,
+	[G_992_3_ANNEX_J_NON_OVERLAPPED] = MOD_G_992_3_Annex_J,
+	[G_992_3_ANNEX_J_OVERLAPPED] = MOD_G_992_3_Annex_J,
 
 	/* Octet 5 - Splitter-less ADSL2 and ADSL2 */
-	case G_992_4_ANNEX_I_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_4);
-	case G_992_4_ANNEX_I_OVERLAPPED: return dsl_mod_str(MOD_G_992_4);
-	case G_992_3_POTS_MODE_1: return dsl_mod_str(MOD_G_992_3_Annex_L);
-	case G_992_3_POTS_MODE_2: return dsl_mod_str(MOD_G_992_3_Annex_L);
-	case G_992_3_POTS_MODE_3: return dsl_mod_str(MOD_G_992_3_Annex_L);
-	case G_992_3_POTS_MODE_4: return dsl_mod_str(MOD_G_992_3_Annex_L);
-	case G_992_3_EXT_POTS_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_M);
-	case G_992_3_EXT_POTS_OVERLAPPED: return dsl_mod_str(MOD_G_992_3_Annex_M);
+	[G_992_4_ANNEX_I_NON_OVERLAPPED] = MOD_G_992_4,
+	[G_992_4_ANNEX_I_OVERLAPPED] = MOD_G_992_4,
+	[G_992_3_POTS_MODE_1] = MOD_G_992_3_Annex_L,
+	[G_992_3_POTS_MODE_2] = MOD_G_992_3_Annex_L,
+	[G_992_3_POTS_MODE_3] = MOD_G_992_3_Annex_L,
+	[G_992_3_POTS_MODE_4] = MOD_G_992_3_Annex_L,
+	[G_992_3_EXT_POTS_NON_OVERLAPPED] = MOD_G_992_3_Annex_M,
+	[G_992_3_EXT_POTS_OVERLAPPED] = MOD_G_992_3_Annex_M,
 
 	/* Octet 6 - ADSL2+ */
-	case G_992_5_POTS_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_A);
-	case G_992_5_POTS_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_A);
-	case G_992_5_ISDN_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_B);
-	case G_992_5_ISDN_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_B);
-	case G_992_5_TCM_ISDN_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_C);
-	case G_992_5_TCM_ISDN_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_C);
-	case G_992_5_ANNEX_I_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_I);
-	case G_992_5_ANNEX_I_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_I);
+	[G_992_5_POTS_NON_OVERLAPPED] = MOD_G_992_5_Annex_A,
+	[G_992_5_POTS_OVERLAPPED] = MOD_G_992_5_Annex_A,
+	[G_992_5_ISDN_NON_OVERLAPPED] = MOD_G_992_5_Annex_B,
+	[G_992_5_ISDN_OVERLAPPED] = MOD_G_992_5_Annex_B,
+	[G_992_5_TCM_ISDN_NON_OVERLAPPED] = MOD_G_992_5_Annex_C,
+	[G_992_5_TCM_ISDN_OVERLAPPED] = MOD_G_992_5_Annex_C,
+	[G_992_5_ANNEX_I_NON_OVERLAPPED] = MOD_G_992_5_Annex_I,
+	[G_992_5_ANNEX_I_OVERLAPPED] = MOD_G_992_5_Annex_I,
 
 	/* Octet 7 - ADSL2+ */
-	case G_992_5_ANNEX_J_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_J);
-	case G_992_5_ANNEX_J_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_J);
-	case G_992_5_EXT_POTS_NON_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_M);
-	case G_992_5_EXT_POTS_OVERLAPPED: return dsl_mod_str(MOD_G_992_5_Annex_M);
+	[G_992_5_ANNEX_J_NON_OVERLAPPED] = MOD_G_992_5_Annex_J,
+	[G_992_5_ANNEX_J_OVERLAPPED] = MOD_G_992_5_Annex_J,
+	[G_992_5_EXT_POTS_NON_OVERLAPPED] = MOD_G_992_5_Annex_M,
+	[G_992_5_EXT_POTS_OVERLAPPED] = MOD_G_992_5_Annex_M,
 	/* Bits 53 - 56 are reserved */
 
 	/* Octet 8 - VDSL2 */
-	case G_993_2_NORTH_AMERICA: return dsl_mod_str(MOD_G_993_2_Annex_A);
-	case G_993_2_EUROPE: return dsl_mod_str(MOD_G_993_2_Annex_B);
-	case G_993_2_JAPAN: return dsl_mod_str(MOD_G_993_2_Annex_C);
+	[G_993_2_NORTH_AMERICA] = MOD_G_993_2_Annex_A,
+	[G_993_2_EUROPE] = MOD_G_993_2_Annex_B,
+	[G_993_2_JAPAN] = MOD_G_993_2_Annex_C,
 	/* Bits 60 - 64 are reserved */
+};
 
-	default:
+static const char * const dsl_line_encoding_strs[] = {
+	[LE_DMT] = "dmt",
+	[LE_CAP] = "cap",
+	[LE_2B1Q] = "2b1q",
+	[LE_43BT] = "43bt",
+	[LE_PAM] = "pam",
+	[LE_QAM] = "qam",
+};
+
+static const char * const dsl_profile_strs[] = {
+	"8a",	// VDSL2_8a
+	"8b",	// VDSL2_8b
+	"8c",	// VDSL2_8c
+	"8b",	// VDSL2_8d
+	"12a",	// VDSL2_12a
+	"12b",	// VDSL2_12b
+	"17a",	// VDSL2_17a
+	"30a",	// VDSL2_30a
+	"35b",	// VDSL2_35b
+};
+
+static const char * const dsl_power_state_strs[] = {
+	[DSL_L0] = "l0",
+	[DSL_L1] = "l1",
+	[DSL_L2] = "l2",
+	[DSL_L3] = "l3",
+	[DSL_L4] = "l4",
+};
+
+static const char * const dsl_link_encap_strs[] = {
+	"adsl2_atm",	// G_992_3_ANNEK_K_ATM
+	"adsl2_ptm",	// G_992_3_ANNEK_K_PTM
+	"vdsl2_atm",	// G_993_2_ANNEK_K_ATM
+	"vdsl2_ptm",	// G_993_2_ANNEK_K_PTM
+	"auto",		// G_994_1_AUTO
+};
+
+/* Returns the string of an enumeration value, "unknown" if it is not in the table */
+static const char *dsl_enum_str(const char * const *strs, size_t num, unsigned long value)
+{
+	return value < num && strs[value] ? strs[value] : "unknown";
+}
+
+/* Returns the string of a bitmap value with exactly one bit set, "unknown" otherwise */
+static const char *dsl_flag_str(const char * const *strs, size_t num, unsigned long value)
+{
+	if (value == 0 || (value & (value - 1)) != 0)
 		return "unknown";
-	}
+
+	return dsl_enum_str(strs, num, __builtin_ctzl(value));
 }
 
-static const char *dsl_line_encoding_str(enum dsl_line_encoding encoding)
+static const char *dsl_if_status_str(unsigned long status)
 {
-	switch (encoding) {
-	case LE_DMT: return "dmt";
-	case LE_CAP: return "cap";
-	case LE_2B1Q: return "2b1q";
-	case LE_43BT: return "43bt";
-	case LE_PAM: return "pam";
-	case LE_QAM: return "qam";
-	default: return "unknown";
-	}
+	return dsl_enum_str(dsl_if_status_strs, ARRAY_SIZE(dsl_if_status_strs), status);
 }
 
-static const char *dsl_profile_str(enum dsl_profile profile)
+static const char *dsl_link_status_str(unsigned long status)
 {
-	switch (profile) {
-	case VDSL2_8a: return "8a";
-	case VDSL2_8b: return "8b";
-	case VDSL2_8c: return "8c";
-	case VDSL2_8d: return "8b";
-	case VDSL2_12a: return "12a";
-	case VDSL2_12b: return "12b";
-	case VDSL2_17a: return "17a";
-	case VDSL2_30a: return "30a";
-	case VDSL2_35b: return "35b";
-	default: return "unknown";
-	}
-};
+	return dsl_enum_str(dsl_link_status_strs, ARRAY_SIZE(dsl_link_status_strs), status);
+}
 
-static const char *dsl_power_state_str(enum dsl_power_state power_state)
+static const char *dsl_mod_str(unsigned long mod)
 {
-	switch (power_state) {
-	case DSL_L0: return "l0";
-	case DSL_L1: return "l1";
-	case DSL_L2: return "l2";
-	case DSL_L3: return "l3";
-	case DSL_L4: return "l4";
-	default: return "unknown";
-	}
-};
+	return dsl_flag_str(dsl_mod_strs, ARRAY_SIZE(dsl_mod_strs), mod);
+}
 
-static void dsl_add_sequence_to_blob(const char *name, bool is_signed, size_t count,
-				const long *head, struct blob_buf *bb)
+static const char *dsl_xtse_str(unsigned long xtse)
 {
-	void *array;
-	size_t i;
+	return dsl_mod_str(xtse < ARRAY_SIZE(dsl_xtse_mods) ? dsl_xtse_mods[xtse] : 0);
+}
 
-	array = blobmsg_open_array(bb, name);
-	for (i = 0; i < count; i++) {
-		if (is_signed)
-			blobmsg_add_u32(bb, "", (uint32_t)head[i]);
-		else
-			blobmsg_add_u64(bb, "", (uint64_t)head[i]);
-	}
-	blobmsg_close_array(bb, array);
+static const char *dsl_line_encoding_str(unsigned long encoding)
+{
+	return dsl_enum_str(dsl_line_encoding_strs, ARRAY_SIZE(dsl_line_encoding_strs), encoding);
 }
 
-static void dsl_add_usds_to_blob(const char *name, bool is_signed, const long *head, struct blob_buf *bb)
+static const char *dsl_profile_str(unsigned long profile)
 {
-	void *table;
+	return dsl_flag_str(dsl_profile_strs, ARRAY_SIZE(dsl_profile_strs), profile);
+}
+
+static const char *dsl_power_state_str(unsigned long power_state)
+{
+	return dsl_enum_str(dsl_power_state_strs, ARRAY_SIZE(dsl_power_state_strs), power_state);
+}
+
+static const char *dsl_link_encap_str(unsigned long encap)
+{
+	return dsl_flag_str(dsl_link_encap_strs, ARRAY_SIZE(dsl_link_encap_strs), encap);
+}
+
+/**
+ * This function returns the XTSE bits from T1_413 to G_993_2_JAPAN as a 64-bit mask, the XTSE
+ * bit n being bit n - 1 of the mask.
+ */
+static uint64_t dsl_xtse_mask(const unsigned char *xtse)
+{
+	uint64_t mask = 0;
 	int i;
 
-	table = blobmsg_open_table(bb, name);
-	for (i = 0; i < 2; i++) {
-		if (is_signed)
-			blobmsg_add_u32(bb, i == 0 ? "us" : "ds", (uint32_t)head[i]);
-		else
-			blobmsg_add_u64(bb, i == 0 ? "us" : "ds", (uint64_t)head[i]);
-	}
-	blobmsg_close_table(bb, table);
+	for (i = 7; i >= 0; i--)
+		mask = (mask << 8) | xtse[i];
+
+	return mask & ((1ULL << G_993_2_JAPAN) - 1);
 }
 
-static void dsl_add_int_to_blob(const char *name, long int value, struct blob_buf *bb)
+/**
+ * enum dsl_field_type - How a field described by struct dsl_field_desc is read and added
+ *
+ * @DSL_TYPE_STRING: char array added as a string
+ * @DSL_TYPE_BOOL: bool added as a u8
+ * @DSL_TYPE_INT: int added as a u32
+ * @DSL_TYPE_U32: unsigned int added as a u32
+ * @DSL_TYPE_U64: unsigned int added as a u64
+ * @DSL_TYPE_UINT64: uint64_t added as a u64
+ * @DSL_TYPE_ENUM: enum added as the string given by format()
+ * @DSL_TYPE_FLAGS: unsigned long bitmap added as an array of the strings given by format() for
+ *                  each bit set from first to last
+ * @DSL_TYPE_LONG_USDS: dsl_long_t added as a table of u32 "us" and "ds"
+ * @DSL_TYPE_ULONG_USDS: dsl_ulong_t added as a table of u64 "us" and "ds"
+ * @DSL_TYPE_LONG_SEQ: dsl_long_sequence_t added as an array of u32
+ * @DSL_TYPE_ULONG_SEQ: dsl_ulong_sequence_t added as an array of u64
+ * @DSL_TYPE_CUSTOM: added by custom() from the whole structure
+ */
+enum dsl_field_type {
+	DSL_TYPE_STRING,
+	DSL_TYPE_BOOL,
+	DSL_TYPE_INT,
+	DSL_TYPE_U32,
+	DSL_TYPE_U64,
+	DSL_TYPE_UINT64,
+	DSL_TYPE_ENUM,
+	DSL_TYPE_FLAGS,
+	DSL_TYPE_LONG_USDS,
+	DSL_TYPE_ULONG_USDS,
+	DSL_TYPE_LONG_SEQ,
+	DSL_TYPE_ULONG_SEQ,
+	DSL_TYPE_CUSTOM,
+};
+
+/**
+ * struct dsl_field_desc - A field of a libdsl structure and how it is added to a blob
+ *
+ * custom_labels() adds the labels of a DSL_TYPE_CUSTOM field to an OpenMetrics info sample.
+ */
+struct dsl_field_desc {
+	const char *key;
+	size_t offset;
+	enum dsl_field_type type;
+	const char *(*format)(unsigned long value);
+	unsigned long first;
+	unsigned long last;
+	void (*custom)(const void *data, struct blob_buf *bb);
+	void (*custom_labels)(const void *data, struct dsl_metrics_buf *buf);
+};
+
+#define DSL_FIELD_KEY(_struct, _key, _member, _type) \
+	{ .key = _key, .offset = offsetof(_struct, _member), .type = _type }
+#define DSL_FIELD(_struct, _member, _type) DSL_FIELD_KEY(_struct, #_member, _member, _type)
+#define DSL_FIELD_ENUM(_struct, _member, _format) \
+	{ .key = #_member, .offset = offsetof(_struct, _member), .type = DSL_TYPE_ENUM, .format = _format }
+#define DSL_FIELD_FLAGS(_struct, _member, _format, _first, _last) \
+	{ .key = #_member, .offset = offsetof(_struct, _member), .type = DSL_TYPE_FLAGS, .format = _format, \
+	  .first = (unsigned long)(_first), .last = (unsigned long)(_last) }
+#define DSL_FIELD_CUSTOM(_struct, _member, _custom, _custom_labels) \
+	{ .key = #_member, .offset = offsetof(_struct, _member), .type = DSL_TYPE_CUSTOM, .custom = _custom, \
+	  .custom_labels = _custom_labels }
+
+/**
+ * This function adds the fields of a structure to the buffer in the order of the descriptors.
+ */
+static void dsl_fields_to_blob(const struct dsl_field_desc *desc, size_t num, const void *data,
+		struct blob_buf *bb)
 {
-	blobmsg_add_u32(bb, name, (uint32_t)value);
+	const struct dsl_field_desc *end = desc + num;
+	const dsl_long_sequence_t *lseq;
+	const dsl_ulong_sequence_t *useq;
+	const dsl_long_t *lpair;
+	const dsl_ulong_t *upair;
+	unsigned long flags;
+	const char *field;
+	void *nested;
+	int i;
+
+	for (; desc < end; desc++) {
+		field = (const char *)data + desc->offset;
+
+		switch (desc->type) {
+		case DSL_TYPE_STRING:
+			blobmsg_add_string(bb, desc->key, field);
+			break;
+		case DSL_TYPE_BOOL:
+			blobmsg_add_u8(bb, desc->key, *(const bool *)field);
+			break;
+		case DSL_TYPE_INT:
+			blobmsg_add_u32(bb, desc->key, (uint32_t)*(const int *)field);
+			break;
+		case DSL_TYPE_U32:
+			blobmsg_add_u32(bb, desc->key, *(const unsigned int *)field);
+			break;
+		case DSL_TYPE_U64:
+			blobmsg_add_u64(bb, desc->key, *(const unsigned int *)field);
+			break;
+		case DSL_TYPE_UINT64:
+			blobmsg_add_u64(bb, desc->key, *(const uint64_t *)field);
+			break;
+		case DSL_TYPE_ENUM:
+			// The enumerations of libdsl have no negative value, hence they are unsigned int
+			blobmsg_add_string(bb, desc->key, desc->format(*(const unsigned int *)field));
+			break;
+		case DSL_TYPE_FLAGS:
+			flags = *(const unsigned long *)field;
+			nested = blobmsg_open_array(bb, desc->key);
+			// From bit first to bit last, one set bit at a time
+			for (flags &= ~(desc->first - 1) & ((desc->last << 1) - 1); flags; flags &= flags - 1)
+				blobmsg_add_string(bb, "", desc->format(flags & -flags));
+			blobmsg_close_array(bb, nested);
+			break;
+		case DSL_TYPE_LONG_USDS:
+			lpair = (const dsl_long_t *)field;
+			nested = blobmsg_open_table(bb, desc->key);
+			blobmsg_add_u32(bb, "us", (uint32_t)lpair->us);
+			blobmsg_add_u32(bb, "ds", (uint32_t)lpair->ds);
+			blobmsg_close_table(bb, nested);
+			break;
+		case DSL_TYPE_ULONG_USDS:
+			upair = (const dsl_ulong_t *)field;
+			nested = blobmsg_open_table(bb, desc->key);
+			blobmsg_add_u64(bb, "us", upair->us);
+			blobmsg_add_u64(bb, "ds", upair->ds);
+			blobmsg_close_table(bb, nested);
+			break;
+		case DSL_TYPE_LONG_SEQ:
+			lseq = (const dsl_long_sequence_t *)field;
+			nested = blobmsg_open_array(bb, desc->key);
+			for (i = 0; i < lseq->count; i++)
+				blobmsg_add_u32(bb, "", (uint32_t)lseq->array[i]);
+			blobmsg_close_array(bb, nested);
+			break;
+		case DSL_TYPE_ULONG_SEQ:
+			useq = (const dsl_ulong_sequence_t *)field;
+			nested = blobmsg_open_array(bb, desc->key);
+			for (i = 0; i < useq->count; i++)
+				blobmsg_add_u64(bb, "", useq->array[i]);
+			blobmsg_close_array(bb, nested);
+			break;
+		case DSL_TYPE_CUSTOM:
+			desc->custom(data, bb);
+			break;
+		}
+	}
 }
 
-static void dsl_status_line_to_blob(const struct dsl_line *line, struct blob_buf *bb)
+/* Returns the status of the interface of a line, consistent with its link status */
+static enum dsl_if_status dsl_line_if_status(const struct dsl_line *line)
 {
-	void *array;
-	int i, j, count;
-	unsigned long opt;
-	char str[64], *modes[ARRAY_SIZE(line->standard_used.xtse) * 8] = { NULL, };
-	enum dsl_if_status if_status = line->status;
-
-	/*
-	 * Put most important information at the beginning
-	 */
-	if (if_status == IF_UP && line->link_status != LINK_UP) {
+	if (line->status == IF_UP && line->link_status != LINK_UP) {
 		/* Some inconsistent status might be retrieved from the driver, i.e. interface status is
 		 * up and the link status is not up. In this case, we force reporting the interface's
 		 * status being down */
-		if_status = IF_DOWN;
+		return IF_DOWN;
+	}
+
+	return line->status;
+}
+
+static void dsl_line_status_to_blob(const void *data, struct blob_buf *bb)
+{
+	blobmsg_add_string(bb, "status", dsl_if_status_str(dsl_line_if_status(data)));
+}
+
+static void dsl_line_status_labels(const void *data, struct dsl_metrics_buf *buf)
+{
+	dsl_metrics_add_label(buf, "status", dsl_if_status_str(dsl_line_if_status(data)));
+}
+
+/* Returns the standard in use in the old format, that of the lowest bit set, or NULL if none */
+static const char *dsl_line_standard_used_str(const struct dsl_line *line)
+{
+	uint64_t mask;
+	unsigned long mode;
+
+	if (line->standard_used.use_xtse) {
+		mask = dsl_xtse_mask(line->standard_used.xtse);
+		return mask ? dsl_xtse_str(__builtin_ctzll(mask) + 1) : NULL;
 	}
-	blobmsg_add_string(bb, "status", dsl_if_status_str(if_status));
-	blobmsg_add_u8(bb, "upstream", line->upstream);
-	blobmsg_add_string(bb, "firmware_version", line->firmware_version);
-	blobmsg_add_string(bb, "link_status", dsl_link_status_str(line->link_status));
-	// standard_used
+
+	mode = line->standard_used.mode & DSL_MOD_ALL;
+	return mode ? dsl_mod_str(mode & -mode) : NULL;
+}
+
+/* Formats the 8 octets of XTSE as hex, 2 digits per octet */
+static void dsl_xtse_hex(char *str, const unsigned char *xtse)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		sprintf(str + 2 * i, "%02x", xtse[i]);
+}
+
+static void dsl_line_standard_used_to_blob(const void *data, struct blob_buf *bb)
+{
+	const struct dsl_line *line = data;
+	const char *standard = dsl_line_standard_used_str(line);
+	void *array;
+	int i;
+	char str[64];
+
 	if (line->standard_used.use_xtse) {
 		array = blobmsg_open_array(bb, "xtse_used");
 		for (i = 0; i < ARRAY_SIZE(line->standard_used.xtse); i++) {
@@ -291,34 +581,36 @@ static void dsl_status_line_to_blob(const struct dsl_line *line, struct blob_buf
 			blobmsg_add_string(bb, "", str);
 		}
 		blobmsg_close_array(bb, array);
+	}
 
-		// For backward compatibility, provide the old format as well
-		for (i = T1_413; i <= G_993_2_JAPAN; i++) {
-			if (XTSE_BIT_GET(line->standard_used.xtse, i)) {
-				blobmsg_add_string(bb, "standard_used", dsl_xtse_str(i));
-				break;
-			}
-		}
-	} else {
-		for (opt = (unsigned long)MOD_G_922_1_ANNEX_A;
-			 opt <= (unsigned long)MOD_G_993_2_Annex_C;
-			 opt <<= 1) {
-			if (line->standard_used.mode & opt) {
-				blobmsg_add_string(bb, "standard_used", dsl_mod_str(opt));
-				break;
-			}
-		}
+	// For backward compatibility, provide the old format as well
+	if (standard)
+		blobmsg_add_string(bb, "standard_used", standard);
+}
+
+static void dsl_line_standard_used_labels(const void *data, struct dsl_metrics_buf *buf)
+{
+	const struct dsl_line *line = data;
+	const char *standard = dsl_line_standard_used_str(line);
+	char str[17];
+
+	if (line->standard_used.use_xtse) {
+		dsl_xtse_hex(str, line->standard_used.xtse);
+		dsl_metrics_add_label(buf, "xtse_used", str);
 	}
-	// current_profile
-	blobmsg_add_string(bb, "current_profile", dsl_profile_str(line->current_profile));
-	blobmsg_add_string(bb, "power_management_state", dsl_power_state_str(line->power_management_state));
-	// max_bit_rate
-	unsigned long rates[] = { line->max_bit_rate.us, line->max_bit_rate.ds };
-	dsl_add_usds_to_blob("max_bit_rate", false, rates, bb);
+	dsl_metrics_add_label(buf, "standard_used", standard ? standard : "");
+}
 
-	blobmsg_add_string(bb, "line_encoding", dsl_line_encoding_str(line->line_encoding));
+static void dsl_line_standard_supported_to_blob(const void *data, struct blob_buf *bb)
+{
+	const struct dsl_line *line = data;
+	void *array;
+	int i;
+	uint64_t mask;
+	unsigned long mode, seen = 0;
+	bool reserved_seen = false;
+	char str[64];
 
-	// standards_supported
 	if (line->standard_supported.use_xtse) {
 		array = blobmsg_open_array(bb, "xtse");
 		for (i = 0; i < ARRAY_SIZE(line->standard_supported.xtse); i++) {
@@ -327,575 +619,2041 @@ static void dsl_status_line_to_blob(const struct dsl_line *line, struct blob_buf
 		}
 		blobmsg_close_array(bb, array);
 
-		// For backward compatibility, provide the old format as well
+		/* For backward compatibility, provide the old format as well. More than one XTSE bits can
+		 * be mapped to the same old standard, which is only added once */
 		array = blobmsg_open_array(bb, "standards_supported");
-		for (i = T1_413, count = 0; i <= G_993_2_JAPAN; i++) {
-			if (XTSE_BIT_GET(line->standard_supported.xtse, i)) {
-				/* More than one XTSE bits can be mapped to the same old standard. So we need to filter
-				 * out the repeated ones. */
-				const char *mod = dsl_xtse_str(i);
-
-				for (j = 0; j < count; j++) {
-					if (strcmp(mod, modes[j]) == 0)
-						break;
-				}
-				if (j == count) {
-					// Not found
-					modes[count++] = mod;
-					blobmsg_add_string(bb, "", mod);
-				}
-			}
+		for (mask = dsl_xtse_mask(line->standard_supported.xtse); mask; mask &= mask - 1) {
+			mode = dsl_xtse_mods[__builtin_ctzll(mask) + 1];
+			if (mode ? (seen & mode) != 0 : reserved_seen)
+				continue;
+
+			seen |= mode;
+			reserved_seen |= !mode;
+			blobmsg_add_string(bb, "", dsl_mod_str(mode));
 		}
 		blobmsg_close_array(bb, array);
 	} else {
 		array = blobmsg_open_array(bb, "standards_supported");
-		for (opt = (unsigned long)MOD_G_922_1_ANNEX_A;
-			 opt <= (unsigned long)MOD_G_993_2_Annex_C;
-			 opt <<= 1) {
-			if (line->standard_supported.mode & opt)
-				blobmsg_add_string(bb, "", dsl_mod_str(opt));
-		}
+		for (mode = line->standard_supported.mode & DSL_MOD_ALL; mode; mode &= mode - 1)
+			blobmsg_add_string(bb, "", dsl_mod_str(mode & -mode));
 		blobmsg_close_array(bb, array);
 	}
+}
+
+/* The supported standards are listed in a single label, separated by commas */
+static void dsl_line_standard_supported_labels(const void *data, struct dsl_metrics_buf *buf)
+{
+	const struct dsl_line *line = data;
+	uint64_t mask;
+	unsigned long mode, modes = 0;
+	bool reserved = false;
+	const char *sep = "";
+	char str[17];
+
+	if (line->standard_supported.use_xtse) {
+		dsl_xtse_hex(str, line->standard_supported.xtse);
+		dsl_metrics_add_label(buf, "xtse", str);
+
+		for (mask = dsl_xtse_mask(line->standard_supported.xtse); mask; mask &= mask - 1) {
+			mode = dsl_xtse_mods[__builtin_ctzll(mask) + 1];
+			modes |= mode;
+			reserved |= !mode;
+		}
+	} else {
+		modes = line->standard_supported.mode & DSL_MOD_ALL;
+	}
+
+	// The names of the standards need no escaping
+	dsl_metrics_printf(buf, ",standards_supported=\"");
+	for (; modes; modes &= modes - 1, sep = ",")
+		dsl_metrics_printf(buf, "%s%s", sep, dsl_mod_str(modes & -modes));
+	if (reserved)
+		dsl_metrics_printf(buf, "%s%s", sep, dsl_mod_str(0));
+	dsl_metrics_printf(buf, "\"");
+}
+
+/* Fields of the line status, the most important ones first */
+static const struct dsl_field_desc dsl_line_fields[] = {
+	DSL_FIELD_CUSTOM(struct dsl_line, status, dsl_line_status_to_blob, dsl_line_status_labels),
+	DSL_FIELD(struct dsl_line, upstream, DSL_TYPE_BOOL),
+	DSL_FIELD(struct dsl_line, firmware_version, DSL_TYPE_STRING),
+	DSL_FIELD_ENUM(struct dsl_line, link_status, dsl_link_status_str),
+	DSL_FIELD_CUSTOM(struct dsl_line, standard_used, dsl_line_standard_used_to_blob,
+			dsl_line_standard_used_labels),
+	DSL_FIELD_ENUM(struct dsl_line, current_profile, dsl_profile_str),
+	DSL_FIELD_ENUM(struct dsl_line, power_management_state, dsl_power_state_str),
+	DSL_FIELD(struct dsl_line, max_bit_rate, DSL_TYPE_ULONG_USDS),
+	DSL_FIELD_ENUM(struct dsl_line, line_encoding, dsl_line_encoding_str),
+	DSL_FIELD_CUSTOM(struct dsl_line, standard_supported, dsl_line_standard_supported_to_blob,
+			dsl_line_standard_supported_labels),
+	DSL_FIELD_FLAGS(struct dsl_line, allowed_profiles, dsl_profile_str, VDSL2_8a, VDSL2_35b),
+	DSL_FIELD(struct dsl_line, success_failure_cause, DSL_TYPE_U32),
+	DSL_FIELD(struct dsl_line, upbokler_pb, DSL_TYPE_ULONG_SEQ),
+	DSL_FIELD(struct dsl_line, rxthrsh_ds, DSL_TYPE_ULONG_SEQ),
+	DSL_FIELD(struct dsl_line, act_ra_mode, DSL_TYPE_ULONG_USDS),
+	DSL_FIELD(struct dsl_line, snr_mroc_us, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line, last_state_transmitted, DSL_TYPE_ULONG_USDS),
+	DSL_FIELD(struct dsl_line, us0_mask, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line, trellis, DSL_TYPE_LONG_USDS),
+	DSL_FIELD(struct dsl_line, act_snr_mode, DSL_TYPE_ULONG_USDS),
+	DSL_FIELD(struct dsl_line, line_number, DSL_TYPE_INT),
+	DSL_FIELD(struct dsl_line, noise_margin, DSL_TYPE_LONG_USDS),
+	DSL_FIELD(struct dsl_line, snr_mpb_us, DSL_TYPE_LONG_SEQ),
+	DSL_FIELD(struct dsl_line, snr_mpb_ds, DSL_TYPE_LONG_SEQ),
+	DSL_FIELD(struct dsl_line, attenuation, DSL_TYPE_LONG_USDS),
+	DSL_FIELD(struct dsl_line, power, DSL_TYPE_LONG_USDS),
+	DSL_FIELD(struct dsl_line, xtur_vendor, DSL_TYPE_STRING),
+	DSL_FIELD(struct dsl_line, xtur_country, DSL_TYPE_STRING),
+	DSL_FIELD(struct dsl_line, xtur_ansi_std, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line, xtur_ansi_rev, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line, xtuc_vendor, DSL_TYPE_STRING),
+	DSL_FIELD(struct dsl_line, xtuc_country, DSL_TYPE_STRING),
+	DSL_FIELD(struct dsl_line, xtuc_ansi_std, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line, xtuc_ansi_rev, DSL_TYPE_U64),
+};
+
+static const struct dsl_field_desc dsl_channel_fields[] = {
+	DSL_FIELD_ENUM(struct dsl_channel, status, dsl_if_status_str),
+	DSL_FIELD_ENUM(struct dsl_channel, link_encapsulation_used, dsl_link_encap_str),
+	DSL_FIELD(struct dsl_channel, curr_rate, DSL_TYPE_ULONG_USDS),
+	DSL_FIELD(struct dsl_channel, actndr, DSL_TYPE_ULONG_USDS),
+	DSL_FIELD_FLAGS(struct dsl_channel, link_encapsulation_supported, dsl_link_encap_str,
+			G_992_3_ANNEK_K_ATM, G_994_1_AUTO),
+	DSL_FIELD(struct dsl_channel, lpath, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_channel, intlvdepth, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_channel, intlvblock, DSL_TYPE_INT),
+	DSL_FIELD(struct dsl_channel, actual_interleaving_delay, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_channel, actinp, DSL_TYPE_INT),
+	DSL_FIELD(struct dsl_channel, inpreport, DSL_TYPE_BOOL),
+	DSL_FIELD(struct dsl_channel, nfec, DSL_TYPE_INT),
+	DSL_FIELD(struct dsl_channel, rfec, DSL_TYPE_INT),
+	DSL_FIELD(struct dsl_channel, lsymb, DSL_TYPE_INT),
+	DSL_FIELD(struct dsl_channel, actinprein, DSL_TYPE_ULONG_USDS),
+};
+
+static void dsl_status_line_to_blob(const struct dsl_line *line, struct blob_buf *bb)
+{
+	dsl_fields_to_blob(dsl_line_fields, ARRAY_SIZE(dsl_line_fields), line, bb);
+}
+
+static void dsl_status_channel_to_blob(const struct dsl_channel *channel, struct blob_buf *bb)
+{
+	dsl_fields_to_blob(dsl_channel_fields, ARRAY_SIZE(dsl_channel_fields), channel, bb);
+}
+
+static struct value2text dsl_stats_types[] = {
+	{ DSL_STATS_TOTAL, "total" },
+	{ DSL_STATS_SHOWTIME, "showtime" },
+	{ DSL_STATS_LASTSHOWTIME, "lastshowtime" },
+	{ DSL_STATS_CURRENTDAY, "currentday" },
+	{ DSL_STATS_QUARTERHOUR, "quarterhour" }
+};
+
+static const struct dsl_field_desc dsl_stats_fields[] = {
+	DSL_FIELD(struct dsl_line_channel_stats, total_start, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line_channel_stats, showtime_start, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line_channel_stats, last_showtime_start, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line_channel_stats, current_day_start, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line_channel_stats, quarter_hour_start, DSL_TYPE_U64),
+};
+
+static const struct dsl_field_desc dsl_line_interval_fields[] = {
+	DSL_FIELD(struct dsl_line_stats_interval, errored_secs, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_line_stats_interval, severely_errored_secs, DSL_TYPE_U64),
+};
+
+static const struct dsl_field_desc dsl_channel_interval_fields[] = {
+	DSL_FIELD(struct dsl_channel_stats_interval, xtur_fec_errors, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_channel_stats_interval, xtuc_fec_errors, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_channel_stats_interval, xtur_hec_errors, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_channel_stats_interval, xtuc_hec_errors, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_channel_stats_interval, xtur_crc_errors, DSL_TYPE_U64),
+	DSL_FIELD(struct dsl_channel_stats_interval, xtuc_crc_errors, DSL_TYPE_U64),
+};
+
+/* The 64-bit counters are added with the suffix "_64" */
+static const struct dsl_field_desc dsl_line_wide_fields[] = {
+	DSL_FIELD_KEY(struct dsl_line_stats_wide, "errored_secs_64", errored_secs, DSL_TYPE_UINT64),
+	DSL_FIELD_KEY(struct dsl_line_stats_wide, "severely_errored_secs_64", severely_errored_secs, DSL_TYPE_UINT64),
+};
+
+static const struct dsl_field_desc dsl_channel_wide_fields[] = {
+	DSL_FIELD_KEY(struct dsl_channel_stats_wide, "xtur_fec_errors_64", xtur_fec_errors, DSL_TYPE_UINT64),
+	DSL_FIELD_KEY(struct dsl_channel_stats_wide, "xtuc_fec_errors_64", xtuc_fec_errors, DSL_TYPE_UINT64),
+	DSL_FIELD_KEY(struct dsl_channel_stats_wide, "xtur_hec_errors_64", xtur_hec_errors, DSL_TYPE_UINT64),
+	DSL_FIELD_KEY(struct dsl_channel_stats_wide, "xtuc_hec_errors_64", xtuc_hec_errors, DSL_TYPE_UINT64),
+	DSL_FIELD_KEY(struct dsl_channel_stats_wide, "xtur_crc_errors_64", xtur_crc_errors, DSL_TYPE_UINT64),
+	DSL_FIELD_KEY(struct dsl_channel_stats_wide, "xtuc_crc_errors_64", xtuc_crc_errors, DSL_TYPE_UINT64),
+};
+
+static void dsl_stats_to_blob(const struct dsl_line_channel_stats *stats, struct blob_buf *bb)
+{
+	dsl_fields_to_blob(dsl_stats_fields, ARRAY_SIZE(dsl_stats_fields), stats, bb);
+}
+
+/* The 64-bit counters, if any for the interval, are added after the 32-bit ones */
+static void dsl_stats_line_interval_to_blob(const struct dsl_line_stats_interval *stats,
+		const struct dsl_line_stats_wide *wide, struct blob_buf *bb)
+{
+	dsl_fields_to_blob(dsl_line_interval_fields, ARRAY_SIZE(dsl_line_interval_fields), stats, bb);
+	if (wide)
+		dsl_fields_to_blob(dsl_line_wide_fields, ARRAY_SIZE(dsl_line_wide_fields), wide, bb);
+}
+
+static void dsl_stats_channel_interval_to_blob(const struct dsl_channel_stats_interval *stats,
+		const struct dsl_channel_stats_wide *wide, struct blob_buf *bb)
+{
+	dsl_fields_to_blob(dsl_channel_interval_fields, ARRAY_SIZE(dsl_channel_interval_fields), stats, bb);
+	if (wide)
+		dsl_fields_to_blob(dsl_channel_wide_fields, ARRAY_SIZE(dsl_channel_wide_fields), wide, bb);
+}
+
+static const struct dsl_line_stats_wide *dsl_line_wide(const struct dsl_snapshot *snap, int type)
+{
+	if (!snap->wide_valid || type - DSL_STATS_TOTAL >= DSL_STATS_WIDE_NUM)
+		return NULL;
+
+	return &snap->wide.line_intervals[type - DSL_STATS_TOTAL];
+}
+
+static const struct dsl_channel_stats_wide *dsl_channel_wide(const struct dsl_snapshot *snap, int type)
+{
+	if (!snap->wide_valid || type - DSL_STATS_TOTAL >= DSL_STATS_WIDE_NUM)
+		return NULL;
+
+	return &snap->wide.channel_intervals[type - DSL_STATS_TOTAL];
+}
+
+/**
+ * struct dsl_metric_instance - A structure whose fields are rendered as metrics
+ *
+ * The labels identify the structure in the samples, e.g. line="0",interval="total".
+ */
+struct dsl_metric_instance {
+	char labels[64];
+	const void *data;
+};
+
+/* At most one instance per line and interval */
+static struct dsl_metric_instance metric_instances[XDSL_MAX_LINES * DSL_STATS_INTERVAL_NUM];
+
+/* Data of the lines which are rendered as metrics */
+enum dsl_metric_data {
+	DSL_METRIC_STATUS,	// struct dsl_line or struct dsl_channel
+	DSL_METRIC_STATS,	// struct dsl_line_channel_stats
+	DSL_METRIC_INTERVALS,	// struct dsl_line_stats_interval or struct dsl_channel_stats_interval
+	DSL_METRIC_WIDE,	// struct dsl_line_stats_wide or struct dsl_channel_stats_wide
+};
+
+static void dsl_metric_add_instance(int *num, int line_num, bool channel, const char *interval,
+		const void *data)
+{
+	struct dsl_metric_instance *inst = &metric_instances[*num];
+	int len;
+
+	len = snprintf(inst->labels, sizeof(inst->labels), "line=\"%d\"", line_num);
+	// The channel of a line has the same number, as the object dsl.channel.x
+	if (channel)
+		len += snprintf(inst->labels + len, sizeof(inst->labels) - len, ",channel=\"%d\"", line_num);
+	if (interval)
+		snprintf(inst->labels + len, sizeof(inst->labels) - len, ",interval=\"%s\"", interval);
+	inst->data = data;
+	(*num)++;
+}
+
+/**
+ * This function fills metric_instances with the data of the lines, or of their channels, which
+ * are valid in the cache.
+ *
+ * @return the number of instances
+ */
+static int dsl_metric_instances(enum dsl_metric_data what, bool channel)
+{
+	const struct dsl_snapshot *snap;
+	const void *data;
+	int max_line = dsl_get_line_number();
+	int i, j, type, num = 0;
+
+	for (i = 0; i < max_line && i < XDSL_MAX_LINES; i++) {
+		snap = what == DSL_METRIC_STATUS ? dsl_cache_peek_status(i) : dsl_cache_peek_stats(i);
+		if (!snap)
+			continue;
+
+		if (what == DSL_METRIC_STATUS) {
+			dsl_metric_add_instance(&num, i, channel, NULL,
+					channel ? (const void *)&snap->channel : (const void *)&snap->line);
+			continue;
+		}
+		if (what == DSL_METRIC_STATS) {
+			dsl_metric_add_instance(&num, i, channel, NULL, channel ? &snap->stats.channel : &snap->stats.line);
+			continue;
+		}
+
+		for (j = 0; j < ARRAY_SIZE(dsl_stats_types); j++) {
+			type = dsl_stats_types[j].value;
+			if (what == DSL_METRIC_INTERVALS)
+				data = channel ? (const void *)&snap->stats.channel_intervals[type - DSL_STATS_TOTAL] :
+					(const void *)&snap->stats.line_intervals[type - DSL_STATS_TOTAL];
+			else
+				data = channel ? (const void *)dsl_channel_wide(snap, type) :
+					(const void *)dsl_line_wide(snap, type);
+			if (data)
+				dsl_metric_add_instance(&num, i, channel, dsl_stats_types[j].text, data);
+		}
+	}
+
+	return num;
+}
+
+/* Starts a sample with the labels of its instance, the caller adds the others and the value */
+static void dsl_metric_sample(struct dsl_metrics_buf *buf, const char *prefix, const char *key,
+		const char *suffix, const struct dsl_metric_instance *inst)
+{
+	dsl_metrics_printf(buf, "%s%s%s{%s", prefix, key, suffix, inst->labels);
+}
+
+/**
+ * This function renders the fields of the instances as OpenMetrics families named prefix + key,
+ * in the order of the descriptors. All samples of a family are rendered together as required by
+ * OpenMetrics, hence the instances are walked for each field.
+ *
+ * The numbers are gauges, or counters if counter is true. The pairs of values get a "direction"
+ * label and the sequences a "band" label. The strings, enumerations and bitmaps are rendered as
+ * info metrics whose label has the name of the field.
+ */
+static void dsl_fields_to_metrics(struct dsl_metrics_buf *buf, const char *prefix,
+		const struct dsl_field_desc *desc, size_t num, const struct dsl_metric_instance *inst,
+		int inst_num, bool counter)
+{
+	const struct dsl_field_desc *end = desc + num;
+	const struct dsl_metric_instance *it, *inst_end = inst + inst_num;
+	const dsl_long_sequence_t *lseq;
+	const dsl_ulong_sequence_t *useq;
+	const dsl_long_t *lpair;
+	const dsl_ulong_t *upair;
+	unsigned long flags;
+	const char *field, *suffix, *sep;
+	int i;
+
+	if (inst_num == 0)
+		return;
+
+	for (; desc < end; desc++) {
+		switch (desc->type) {
+		case DSL_TYPE_STRING:
+		case DSL_TYPE_ENUM:
+		case DSL_TYPE_FLAGS:
+		case DSL_TYPE_CUSTOM:
+			dsl_metrics_printf(buf, "# TYPE %s%s info\n", prefix, desc->key);
+			suffix = "_info";
+			break;
+		default:
+			dsl_metrics_printf(buf, "# TYPE %s%s %s\n", prefix, desc->key, counter ? "counter" : "gauge");
+			suffix = counter ? "_total" : "";
+			break;
+		}
+
+		for (it = inst; it < inst_end; it++) {
+			field = (const char *)it->data + desc->offset;
+
+			switch (desc->type) {
+			case DSL_TYPE_STRING:
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_add_label(buf, desc->key, field);
+				dsl_metrics_printf(buf, "} 1\n");
+				break;
+			case DSL_TYPE_BOOL:
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_printf(buf, "} %d\n", *(const bool *)field ? 1 : 0);
+				break;
+			case DSL_TYPE_INT:
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_printf(buf, "} %d\n", *(const int *)field);
+				break;
+			case DSL_TYPE_U32:
+			case DSL_TYPE_U64:
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_printf(buf, "} %u\n", *(const unsigned int *)field);
+				break;
+			case DSL_TYPE_UINT64:
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_printf(buf, "} %" PRIu64 "\n", *(const uint64_t *)field);
+				break;
+			case DSL_TYPE_ENUM:
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_add_label(buf, desc->key, desc->format(*(const unsigned int *)field));
+				dsl_metrics_printf(buf, "} 1\n");
+				break;
+			case DSL_TYPE_FLAGS:
+				// The names of the bits need no escaping, they are listed separated by commas
+				flags = *(const unsigned long *)field;
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_printf(buf, ",%s=\"", desc->key);
+				sep = "";
+				for (flags &= ~(desc->first - 1) & ((desc->last << 1) - 1); flags; flags &= flags - 1) {
+					dsl_metrics_printf(buf, "%s%s", sep, desc->format(flags & -flags));
+					sep = ",";
+				}
+				dsl_metrics_printf(buf, "\"} 1\n");
+				break;
+			case DSL_TYPE_LONG_USDS:
+				lpair = (const dsl_long_t *)field;
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_printf(buf, ",direction=\"us\"} %ld\n", lpair->us);
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_printf(buf, ",direction=\"ds\"} %ld\n", lpair->ds);
+				break;
+			case DSL_TYPE_ULONG_USDS:
+				upair = (const dsl_ulong_t *)field;
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_printf(buf, ",direction=\"us\"} %lu\n", upair->us);
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				dsl_metrics_printf(buf, ",direction=\"ds\"} %lu\n", upair->ds);
+				break;
+			case DSL_TYPE_LONG_SEQ:
+				lseq = (const dsl_long_sequence_t *)field;
+				for (i = 0; i < lseq->count && i < ARRAY_SIZE(lseq->array); i++) {
+					dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+					dsl_metrics_printf(buf, ",band=\"%d\"} %ld\n", i, lseq->array[i]);
+				}
+				break;
+			case DSL_TYPE_ULONG_SEQ:
+				useq = (const dsl_ulong_sequence_t *)field;
+				for (i = 0; i < useq->count && i < ARRAY_SIZE(useq->array); i++) {
+					dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+					dsl_metrics_printf(buf, ",band=\"%d\"} %lu\n", i, useq->array[i]);
+				}
+				break;
+			case DSL_TYPE_CUSTOM:
+				dsl_metric_sample(buf, prefix, desc->key, suffix, it);
+				desc->custom_labels(it->data, buf);
+				dsl_metrics_printf(buf, "} 1\n");
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * This function renders all cached data of the lines and their channels in the OpenMetrics text
+ * format, replacing the content of the buffer. The lines whose data are not valid are left out.
+ *
+ * @return 0 on success, -1 if the buffer could not grow or the backend has not been probed yet
+ */
+int dsl_metrics_render(struct dsl_metrics_buf *buf)
+{
+	int num;
+
+	buf->len = 0;
+	buf->error = false;
+
+	if (!dslmngr_startup.ready)
+		return -1;
+
+	num = dsl_metric_instances(DSL_METRIC_STATUS, false);
+	dsl_fields_to_metrics(buf, "dsl_line_", dsl_line_fields, ARRAY_SIZE(dsl_line_fields),
+			metric_instances, num, false);
+	num = dsl_metric_instances(DSL_METRIC_STATUS, true);
+	dsl_fields_to_metrics(buf, "dsl_channel_", dsl_channel_fields, ARRAY_SIZE(dsl_channel_fields),
+			metric_instances, num, false);
+
+	num = dsl_metric_instances(DSL_METRIC_STATS, false);
+	dsl_fields_to_metrics(buf, "dsl_line_", dsl_stats_fields, ARRAY_SIZE(dsl_stats_fields),
+			metric_instances, num, false);
+	num = dsl_metric_instances(DSL_METRIC_INTERVALS, false);
+	dsl_fields_to_metrics(buf, "dsl_line_", dsl_line_interval_fields, ARRAY_SIZE(dsl_line_interval_fields),
+			metric_instances, num, false);
+	// Unlike the 32-bit counters of the backend, the 64-bit ones never decrease
+	num = dsl_metric_instances(DSL_METRIC_WIDE, false);
+	dsl_fields_to_metrics(buf, "dsl_line_", dsl_line_wide_fields, ARRAY_SIZE(dsl_line_wide_fields),
+			metric_instances, num, true);
+
+	num = dsl_metric_instances(DSL_METRIC_STATS, true);
+	dsl_fields_to_metrics(buf, "dsl_channel_", dsl_stats_fields, ARRAY_SIZE(dsl_stats_fields),
+			metric_instances, num, false);
+	num = dsl_metric_instances(DSL_METRIC_INTERVALS, true);
+	dsl_fields_to_metrics(buf, "dsl_channel_", dsl_channel_interval_fields,
+			ARRAY_SIZE(dsl_channel_interval_fields), metric_instances, num, false);
+	num = dsl_metric_instances(DSL_METRIC_WIDE, true);
+	dsl_fields_to_metrics(buf, "dsl_channel_", dsl_channel_wide_fields, ARRAY_SIZE(dsl_channel_wide_fields),
+			metric_instances, num, true);
+
+	dsl_metrics_printf(buf, "# EOF\n");
+
+	return buf->error ? -1 : 0;
+}
+
+/**
+ * Serializers of the cached replies. The variant selects the statistics interval, 0 for all
+ * statistics or "enum dsl_stats_type" for a single interval.
+ */
+typedef void (*dsl_serialize_cb)(const struct dsl_snapshot *snap, int variant, struct blob_buf *bb);
+
+static void dsl_line_status_serialize(const struct dsl_snapshot *snap, int variant, struct blob_buf *bb)
+{
+	dsl_status_line_to_blob(&snap->line, bb);
+}
+
+static void dsl_channel_status_serialize(const struct dsl_snapshot *snap, int variant, struct blob_buf *bb)
+{
+	dsl_status_channel_to_blob(&snap->channel, bb);
+}
+
+static void dsl_line_stats_serialize(const struct dsl_snapshot *snap, int variant, struct blob_buf *bb)
+{
+	void *table;
+	int i;
+
+	if (variant != 0) {
+		dsl_stats_line_interval_to_blob(&snap->stats.line_intervals[variant - DSL_STATS_TOTAL],
+				dsl_line_wide(snap, variant), bb);
+		return;
+	}
+
+	dsl_stats_to_blob(&snap->stats.line, bb);
+	for (i = 0; i < ARRAY_SIZE(dsl_stats_types); i++) {
+		table = blobmsg_open_table(bb, dsl_stats_types[i].text);
+		dsl_stats_line_interval_to_blob(&snap->stats.line_intervals[dsl_stats_types[i].value - DSL_STATS_TOTAL],
+				dsl_line_wide(snap, dsl_stats_types[i].value), bb);
+		blobmsg_close_table(bb, table);
+	}
+}
+
+static void dsl_channel_stats_serialize(const struct dsl_snapshot *snap, int variant, struct blob_buf *bb)
+{
+	void *table;
+	int i;
+
+	if (variant != 0) {
+		dsl_stats_channel_interval_to_blob(&snap->stats.channel_intervals[variant - DSL_STATS_TOTAL],
+				dsl_channel_wide(snap, variant), bb);
+		return;
+	}
+
+	dsl_stats_to_blob(&snap->stats.channel, bb);
+	for (i = 0; i < ARRAY_SIZE(dsl_stats_types); i++) {
+		table = blobmsg_open_table(bb, dsl_stats_types[i].text);
+		dsl_stats_channel_interval_to_blob(
+			&snap->stats.channel_intervals[dsl_stats_types[i].value - DSL_STATS_TOTAL],
+			dsl_channel_wide(snap, dsl_stats_types[i].value), bb);
+		blobmsg_close_table(bb, table);
+	}
+}
+
+static int dsl_field_cmp(const void *key, const void *elem)
+{
+	return strcmp(key, *(const char * const *)elem);
+}
+
+static int dsl_field_index(const char *name)
+{
+	const char * const *found;
+
+	found = bsearch(name, dsl_field_names, ARRAY_SIZE(dsl_field_names), sizeof(dsl_field_names[0]),
+			dsl_field_cmp);
+
+	return found ? (int)(found - dsl_field_names) : -1;
+}
+
+static bool dsl_field_selected(const struct dsl_field_mask *fields, int idx)
+{
+	if (!fields || fields->all)
+		return true;
+
+	return idx >= 0 && (fields->bits[idx / 32] & (1U << (idx % 32)));
+}
+
+/**
+ * This function compiles the "fields" argument of a request, an array of field names, into a
+ * mask. All fields are selected if attr is NULL.
+ *
+ * @return 0 on success, -1 if a name is not a field
+ */
+static int dsl_parse_fields(struct blob_attr *attr, struct dsl_field_mask *fields)
+{
+	struct blob_attr *cur;
+	int rem, idx;
+
+	memset(fields, 0, sizeof(*fields));
+	if (!attr) {
+		fields->all = true;
+		return 0;
+	}
+
+	blobmsg_for_each_attr(cur, attr, rem) {
+		if (blobmsg_type(cur) != BLOBMSG_TYPE_STRING)
+			return -1;
+
+		idx = dsl_field_index(blobmsg_get_string(cur));
+		if (idx < 0) {
+			DSLMNGR_LOG(LOG_ERR, "Unknown field %s\n", blobmsg_get_string(cur));
+			return -1;
+		}
+		fields->bits[idx / 32] |= 1U << (idx % 32);
+	}
+
+	return 0;
+}
+
+/**
+ * struct dsl_reply_cache - Serialized reply content and the generation of the data it was built from
+ *
+ * field_gen[i] is the generation at which the i-th field of the content was last found different
+ * from its previous serialization. Fields whose generation is greater than the one a client has
+ * seen are those which changed since. removed holds the fields which are no longer in the content,
+ * e.g. "xtse_used" once "standard_used" is returned instead, and removed_gen[i] the generation at
+ * which the i-th of them disappeared.
+ */
+struct dsl_reply_cache {
+	uint32_t gen;
+	struct blob_attr *attr;
+	uint32_t *field_gen;
+	/* Index of each field of the content in dsl_field_names, -1 if it cannot be selected */
+	int16_t *field_idx;
+	struct blob_attr *removed;
+	uint32_t *removed_gen;
+};
+
+/** struct dsl_line_replies - Cached replies of a line and its channel */
+struct dsl_line_replies {
+	struct dsl_reply_cache line_status;
+	struct dsl_reply_cache channel_status;
+	/* Index 0 is for all statistics, the others are indexed by "enum dsl_stats_type" */
+	struct dsl_reply_cache line_stats[DSL_STATS_INTERVAL_NUM + 1];
+	struct dsl_reply_cache channel_stats[DSL_STATS_INTERVAL_NUM + 1];
+};
+
+static struct dsl_line_replies *replies;
+
+/* All replies are built in this buffer whose memory is kept from one request to the next */
+static struct blob_buf reply_bb;
+
+/* Returns the field of the content at pos if it lies within the content, NULL otherwise */
+static struct blob_attr *dsl_reply_field_at(struct blob_attr *content, struct blob_attr *pos)
+{
+	char *end = (char *)blob_data(content) + blob_len(content);
+
+	if ((char *)pos + sizeof(*pos) > end || (char *)pos + blob_pad_len(pos) > end)
+		return NULL;
+
+	return pos;
+}
+
+/* Returns the field of the content with the given name and its position in pos, NULL if none */
+static struct blob_attr *dsl_reply_field_find(struct blob_attr *content, const char *name, int *pos)
+{
+	struct blob_attr *cur;
+	int rem, i = 0;
+
+	blob_for_each_attr(cur, content, rem) {
+		if (strcmp(blobmsg_name(cur), name) == 0) {
+			*pos = i;
+			return cur;
+		}
+		i++;
+	}
+
+	return NULL;
+}
+
+/**
+ * This function compares newly serialized content with the cached one field by field and returns
+ * the field generations of the new content, NULL if out of memory. The index of each field in
+ * dsl_field_names is returned in idx, and whether the names of the fields are the same as in the
+ * cached content in same_keys.
+ */
+static uint32_t *dsl_reply_field_gens(const struct dsl_reply_cache *rc, struct blob_attr *attr, uint32_t gen,
+		int16_t **idx, bool *same_keys)
+{
+	struct blob_attr *cur, *match, *old = NULL;
+	uint32_t *gens;
+	int rem, count = 0, i = 0, j = 0;
+
+	blob_for_each_attr(cur, attr, rem)
+		count++;
+
+	gens = calloc(count > 0 ? count : 1, sizeof(*gens));
+	*idx = calloc(count > 0 ? count : 1, sizeof(**idx));
+	if (!gens || !*idx) {
+		free(gens);
+		free(*idx);
+		*idx = NULL;
+		return NULL;
+	}
+
+	*same_keys = rc->attr != NULL;
+	if (rc->attr)
+		old = dsl_reply_field_at(rc->attr, blob_data(rc->attr));
+
+	blob_for_each_attr(cur, attr, rem) {
+		gens[i] = gen;
+		(*idx)[i] = (int16_t)dsl_field_index(blobmsg_name(cur));
+
+		// The fields are serialized in a fixed order, so the previous content is walked along and
+		// only searched when a field has been added or removed
+		match = old;
+		if (!old || strcmp(blobmsg_name(old), blobmsg_name(cur)) != 0) {
+			*same_keys = false;
+			match = dsl_reply_field_find(rc->attr, blobmsg_name(cur), &j);
+		}
+
+		// An unchanged field keeps the generation it had in the previous content
+		if (match) {
+			if (blob_attr_equal(match, cur))
+				gens[i] = rc->field_gen[j];
+			old = dsl_reply_field_at(rc->attr, blob_next(match));
+			j++;
+		}
+		i++;
+	}
+
+	// Fields left at the end of the previous content have been removed
+	if (old)
+		*same_keys = false;
+
+	return gens;
+}
+
+/**
+ * This function updates the fields removed from the cached content once it is replaced by new
+ * content with other field names. The fields of the cached content which are not in the new one
+ * are removed at generation gen, and those removed before are kept until they are returned again.
+ */
+static void dsl_reply_update_removed(struct dsl_reply_cache *rc, struct blob_attr *attr, uint32_t gen)
+{
+	static struct blob_buf removed;
+	struct blob_attr *cur, *content;
+	uint32_t *gens;
+	int rem, pos, count = 0, i = 0;
+
+	blob_buf_init(&removed, 0);
+	blob_for_each_attr(cur, rc->removed, rem)
+		count++;
+	blob_for_each_attr(cur, rc->attr, rem)
+		count++;
+
+	gens = calloc(count > 0 ? count : 1, sizeof(*gens));
+	if (gens) {
+		count = 0;
+		blob_for_each_attr(cur, rc->removed, rem) {
+			if (!dsl_reply_field_find(attr, blobmsg_name(cur), &pos)) {
+				blobmsg_add_field(&removed, BLOBMSG_TYPE_UNSPEC, blobmsg_name(cur), "", 0);
+				gens[count++] = rc->removed_gen[i];
+			}
+			i++;
+		}
+		blob_for_each_attr(cur, rc->attr, rem) {
+			if (!dsl_reply_field_find(attr, blobmsg_name(cur), &pos)) {
+				blobmsg_add_field(&removed, BLOBMSG_TYPE_UNSPEC, blobmsg_name(cur), "", 0);
+				gens[count++] = gen;
+			}
+		}
+	}
+
+	content = gens && count > 0 ? blob_memdup(removed.head) : NULL;
+	if (gens && count > 0 && !content)
+		DSLMNGR_LOG(LOG_ERR, "Out of memory\n");
+
+	free(rc->removed);
+	free(rc->removed_gen);
+	rc->removed = content;
+	rc->removed_gen = content ? gens : NULL;
+	if (!content)
+		free(gens);
+}
+
+/**
+ * This function adds the members of a table which are selected by the mask, e.g. the selected
+ * counters of an interval of the statistics. The table is left out if none is selected.
+ *
+ * @return true if the table has been added
+ */
+static bool dsl_add_selected_members(struct blob_buf *bb, struct blob_attr *table,
+		const struct dsl_field_mask *fields)
+{
+	struct blob_attr *cur;
+	void *cookie = NULL;
+	int rem;
+
+	blobmsg_for_each_attr(cur, table, rem) {
+		if (!dsl_field_selected(fields, dsl_field_index(blobmsg_name(cur))))
+			continue;
+
+		if (!cookie)
+			cookie = blobmsg_open_table(bb, blobmsg_name(table));
+		blobmsg_add_blob(bb, cur);
+	}
+	if (cookie)
+		blobmsg_close_table(bb, cookie);
+
+	return cookie != NULL;
+}
+
+/**
+ * This function adds the reply content for a snapshot to the buffer. The content is serialized
+ * only if the data have changed since it was cached. Otherwise the cached content is copied.
+ *
+ * Only the fields which changed after generation "since" are added, all of them if it is 0, along
+ * with those removed after it with a null value. Of these, only the fields selected by the mask
+ * are added, all of them if it is NULL. A table which is not selected itself, e.g. an interval of
+ * the statistics, is added with its selected members.
+ *
+ * @return true if any field has been added
+ */
+static bool dsl_add_cached_reply(struct blob_buf *bb, struct dsl_reply_cache *rc, uint32_t gen,
+		const struct dsl_snapshot *snap, int variant, dsl_serialize_cb serialize, uint32_t since,
+		const struct dsl_field_mask *fields)
+{
+	static struct blob_buf scratch;
+	struct blob_attr *cur, *removed;
+	uint32_t *gens;
+	int16_t *idx;
+	bool changed = false, same_keys;
+	int rem, i;
+
+	if (!rc->attr || rc->gen != gen) {
+		blob_buf_init(&scratch, 0);
+		serialize(snap, variant, &scratch);
+
+		gens = dsl_reply_field_gens(rc, scratch.head, gen, &idx, &same_keys);
+		if (gens && !same_keys)
+			dsl_reply_update_removed(rc, scratch.head, gen);
+		free(rc->attr);
+		free(rc->field_gen);
+		free(rc->field_idx);
+		rc->attr = gens ? blob_memdup(scratch.head) : NULL;
+		rc->field_gen = gens;
+		rc->field_idx = idx;
+		rc->gen = gen;
+		if (!rc->attr) {
+			DSLMNGR_LOG(LOG_ERR, "Out of memory\n");
+			free(rc->field_gen);
+			free(rc->field_idx);
+			rc->field_gen = NULL;
+			rc->field_idx = NULL;
+			serialize(snap, variant, bb);
+			return true;
+		}
+	}
+
+	if (since == 0 && (!fields || fields->all)) {
+		blob_put_raw(bb, blob_data(rc->attr), blob_len(rc->attr));
+		return blob_len(rc->attr) > 0;
+	}
+
+	i = 0;
+	blob_for_each_attr(cur, rc->attr, rem) {
+		if (rc->field_gen[i] > since) {
+			if (dsl_field_selected(fields, rc->field_idx[i])) {
+				blobmsg_add_blob(bb, cur);
+				changed = true;
+			} else if (blobmsg_type(cur) == BLOBMSG_TYPE_TABLE) {
+				changed |= dsl_add_selected_members(bb, cur, fields);
+			}
+		}
+		i++;
+	}
+
+	// The fields removed since are returned with a null value
+	removed = since ? rc->removed : NULL;
+	i = 0;
+	blob_for_each_attr(cur, removed, rem) {
+		if (rc->removed_gen[i] > since && dsl_field_selected(fields, dsl_field_index(blobmsg_name(cur)))) {
+			blobmsg_add_blob(bb, cur);
+			changed = true;
+		}
+		i++;
+	}
+
+	return changed;
+}
+
+/**
+ * This function returns the generation a client has already seen. A generation newer than the
+ * current one, e.g. from before dslmngr restarted, is ignored so that all fields are returned.
+ */
+static uint32_t dsl_parse_since(struct blob_attr *attr)
+{
+	uint32_t since;
+
+	if (!attr)
+		return 0;
+
+	since = blobmsg_get_u32(attr);
+	return since > dsl_cache_generation() ? 0 : since;
+}
+
+static void dsl_add_reply_trailer(struct blob_buf *bb, uint32_t since, bool changed)
+{
+	blobmsg_add_u32(bb, DSL_GENERATION, dsl_cache_generation());
+	if (since)
+		blobmsg_add_u8(bb, "changed", changed);
+}
+
+/**
+ * This function parses the reply format, "json" by default or "binary". The binary format carries
+ * whole structures, hence it cannot be combined with a selection of fields.
+ */
+static int dsl_parse_format(struct blob_attr *attr, const struct dsl_field_mask *fields, bool *binary)
+{
+	const char *format;
+
+	*binary = false;
+	if (!attr)
+		return 0;
+
+	format = blobmsg_data(attr);
+	if (strcasecmp(format, "binary") == 0)
+		*binary = true;
+	else if (strcasecmp(format, "json") != 0) {
+		DSLMNGR_LOG(LOG_ERR, "Wrong argument for reply format\n");
+		return -1;
+	}
+
+	return *binary && !fields->all ? -1 : 0;
+}
+
+static int dsl_parse_stats_args(struct blob_attr *msg, enum dsl_stats_type *type, uint32_t *since,
+		struct dsl_field_mask *fields, bool *binary)
+{
+	struct blob_attr *tb[__DSL_STATS_MAX];
+	int i;
+
+	*type = 0;
+	*since = 0;
+
+	// Parse and validation check the interval type if any
+	blobmsg_parse(dsl_stats_policy, __DSL_STATS_MAX, tb, blob_data(msg), blob_len(msg));
+	if (tb[DSL_STATS_INTERVAL]) {
+		const char *st = blobmsg_data(tb[DSL_STATS_INTERVAL]);
+
+		for (i = 0; i < ARRAY_SIZE(dsl_stats_types); i++) {
+			if (strcasecmp(st, dsl_stats_types[i].text) == 0) {
+				*type = dsl_stats_types[i].value;
+				break;
+			}
+		}
+
+		if (i >= ARRAY_SIZE(dsl_stats_types)) {
+			DSLMNGR_LOG(LOG_ERR, "Wrong argument for interval statistics type\n");
+			return -1;
+		}
+	}
+
+	*since = dsl_parse_since(tb[DSL_STATS_SINCE]);
+
+	if (dsl_parse_fields(tb[DSL_STATS_FIELDS], fields) != 0)
+		return -1;
+
+	return dsl_parse_format(tb[DSL_STATS_FORMAT], fields, binary);
+}
+
+static int dsl_parse_status_args(struct blob_attr *msg, uint32_t *since, struct dsl_field_mask *fields,
+		bool *binary)
+{
+	struct blob_attr *tb[__DSL_STATUS_MAX];
+
+	blobmsg_parse(dsl_status_policy, __DSL_STATUS_MAX, tb, blob_data(msg), blob_len(msg));
+
+	*since = dsl_parse_since(tb[DSL_STATUS_SINCE]);
+
+	if (dsl_parse_fields(tb[DSL_STATUS_FIELDS], fields) != 0)
+		return -1;
+
+	return dsl_parse_format(tb[DSL_STATUS_FORMAT], fields, binary);
+}
+
+struct dsl_deferred_request;
+
+/**
+ * struct dsl_request - Arguments of a status or stats request
+ *
+ * num is the line or channel number, -1 for all lines. reply() builds and sends the reply from
+ * the cached data. fetch(), if any, reads the other data of the reply once the cached data are
+ * fresh, in the worker threads if dr is not NULL. It returns true if dr is then completed later.
+ */
+struct dsl_request {
+	int num;
+	bool stats;
+	enum dsl_stats_type type;
+	uint32_t since;
+	struct dsl_field_mask fields;
+	bool binary;
+	struct dsl_tones_request tones;
+	enum dsl_debug_method method;
+	int (*reply)(struct ubus_context *ctx, struct ubus_request_data *req, const struct dsl_request *args);
+	bool (*fetch)(const struct dsl_request *args, struct dsl_deferred_request *dr);
+};
+
+/** struct dsl_deferred_request - A request answered once its data have been refreshed */
+struct dsl_deferred_request {
+	struct ubus_context *ctx;
+	struct ubus_request_data req;
+	struct dsl_request args;
+	struct dsl_cache_waiter waiter;
+	struct dsl_tones_waiter tones_waiter;
+	/** When the request was deferred, in microseconds */
+	uint64_t start;
+};
+
+/* Method being answered and when its reply began to be built, the replies being built one at a time */
+static enum dsl_debug_method reply_method;
+static uint64_t reply_start;
+
+static void dsl_reply_begin(enum dsl_debug_method method)
+{
+	reply_method = method;
+	reply_start = dsl_debug_now();
+}
+
+static int dsl_reply(struct ubus_context *ctx, struct ubus_request_data *req, const struct dsl_request *args)
+{
+	dsl_reply_begin(args->method);
+	return args->reply(ctx, req, args);
+}
+
+/* Sends the reply built in reply_bb, recording how long it took to build and to send it */
+static void dsl_send_reply(struct ubus_context *ctx, struct ubus_request_data *req)
+{
+	uint64_t now = dsl_debug_record(reply_method, DSL_DEBUG_SERIALIZE, reply_start);
+
+	ubus_send_reply(ctx, req, reply_bb.head);
+	dsl_debug_record(reply_method, DSL_DEBUG_SEND, now);
+}
+
+static void dsl_deferred_request_complete(struct dsl_deferred_request *dr)
+{
+	dsl_debug_record(dr->args.method, DSL_DEBUG_BACKEND, dr->start);
+	ubus_complete_deferred_request(dr->ctx, &dr->req, dsl_reply(dr->ctx, &dr->req, &dr->args));
+	free(dr);
+}
+
+static void dsl_deferred_request_cb(struct dsl_cache_waiter *waiter)
+{
+	struct dsl_deferred_request *dr = container_of(waiter, struct dsl_deferred_request, waiter);
+
+	if (dr->args.fetch && dr->args.fetch(&dr->args, dr))
+		return;
+
+	dsl_deferred_request_complete(dr);
+}
+
+/**
+ * This function answers a request right away if its data are in the cache. Otherwise the request
+ * is deferred and answered once the worker threads have refreshed the data, so that a slow backend
+ * call does not hold up the requests of other UBUS clients.
+ */
+static int dsl_handle_request(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	struct dsl_deferred_request *dr;
+	uint64_t start;
+
+	// Nothing can be read before the backend has been probed
+	if (!dslmngr_startup.ready)
+		return UBUS_STATUS_NO_DATA;
+
+	if (!args->fetch && dsl_cache_fresh(args->num, !args->stats, args->stats))
+		return dsl_reply(ctx, req, args);
+
+	start = dsl_debug_now();
+	dr = calloc(1, sizeof(*dr));
+	if (dr) {
+		dr->ctx = ctx;
+		dr->args = *args;
+		dr->waiter.cb = dsl_deferred_request_cb;
+		dr->start = start;
+		switch (dsl_cache_refresh_async(&dr->waiter, args->num, !args->stats, args->stats)) {
+		case 1:
+			// The cached data are fresh, the other data of the reply may still have to be read
+			if (!args->fetch || !args->fetch(&dr->args, dr)) {
+				free(dr);
+				return dsl_reply(ctx, req, args);
+			}
+			// fall through
+		case 0:
+			ubus_defer_request(ctx, req, &dr->req);
+			return UBUS_STATUS_OK;
+		}
+		free(dr);
+	}
+
+	// No worker thread or too many pending requests, call the backend from here
+	dsl_cache_refresh(args->num, !args->stats, args->stats);
+	if (args->fetch)
+		args->fetch(args, NULL);
+	dsl_debug_record(args->method, DSL_DEBUG_BACKEND, start);
+	return dsl_reply(ctx, req, args);
+}
+
+/* Image of a binary reply, the header being followed by the structure given by its type */
+static struct dsl_binary_reply {
+	struct dsl_binary_header header;
+	union {
+		struct dsl_line line;
+		struct dsl_channel channel;
+		struct dsl_binary_line_stats line_stats;
+		struct dsl_binary_channel_stats channel_stats;
+	} data;
+} binary_reply;
+
+/**
+ * This function adds the "data" field of a binary reply from the structure already copied into
+ * binary_reply, unless it has not changed after generation "since".
+ *
+ * @return true if the field has been added
+ */
+static bool dsl_add_binary_reply(struct blob_buf *bb, enum dsl_binary_type type, size_t size, uint32_t gen,
+		uint32_t since)
+{
+	if (gen <= since)
+		return false;
+
+	binary_reply.header.version = DSL_BINARY_VERSION;
+	binary_reply.header.byte_order = DSL_BINARY_BYTE_ORDER;
+	binary_reply.header.type = type;
+	binary_reply.header.header_size = offsetof(struct dsl_binary_reply, data);
+	binary_reply.header.size = size;
+	binary_reply.header.gen = gen;
+	blobmsg_add_field(bb, BLOBMSG_TYPE_UNSPEC, "data", &binary_reply, binary_reply.header.header_size + size);
+
+	return true;
+}
+
+/* Adds the status of a line or of its channel in the requested format */
+static bool dsl_add_status_reply(struct blob_buf *bb, int num, const struct dsl_snapshot *snap, bool channel,
+		const struct dsl_request *args)
+{
+	if (args->binary && channel) {
+		memcpy(&binary_reply.data.channel, &snap->channel, sizeof(snap->channel));
+		return dsl_add_binary_reply(bb, DSL_BINARY_CHANNEL, sizeof(snap->channel), snap->status_gen,
+				args->since);
+	} else if (args->binary) {
+		memcpy(&binary_reply.data.line, &snap->line, sizeof(snap->line));
+		return dsl_add_binary_reply(bb, DSL_BINARY_LINE, sizeof(snap->line), snap->status_gen, args->since);
+	}
+
+	return dsl_add_cached_reply(bb, channel ? &replies[num].channel_status : &replies[num].line_status,
+			snap->status_gen, snap, 0, channel ? dsl_channel_status_serialize : dsl_line_status_serialize,
+			args->since, &args->fields);
+}
+
+/* Adds the statistics of a line or of its channel in the requested format, all intervals if binary */
+static bool dsl_add_stats_reply(struct blob_buf *bb, int num, const struct dsl_snapshot *snap, bool channel,
+		const struct dsl_request *args)
+{
+	struct dsl_binary_line_stats *line_stats = &binary_reply.data.line_stats;
+	struct dsl_binary_channel_stats *channel_stats = &binary_reply.data.channel_stats;
+
+	if (args->binary && channel) {
+		memset(channel_stats, 0, sizeof(*channel_stats));
+		memcpy(&channel_stats->stats, &snap->stats.channel, sizeof(channel_stats->stats));
+		memcpy(channel_stats->intervals, snap->stats.channel_intervals, sizeof(channel_stats->intervals));
+		if (snap->wide_valid)
+			memcpy(channel_stats->wide, snap->wide.channel_intervals, sizeof(channel_stats->wide));
+		return dsl_add_binary_reply(bb, DSL_BINARY_CHANNEL_STATS, sizeof(*channel_stats), snap->stats_gen,
+				args->since);
+	} else if (args->binary) {
+		memset(line_stats, 0, sizeof(*line_stats));
+		memcpy(&line_stats->stats, &snap->stats.line, sizeof(line_stats->stats));
+		memcpy(line_stats->intervals, snap->stats.line_intervals, sizeof(line_stats->intervals));
+		if (snap->wide_valid)
+			memcpy(line_stats->wide, snap->wide.line_intervals, sizeof(line_stats->wide));
+		return dsl_add_binary_reply(bb, DSL_BINARY_LINE_STATS, sizeof(*line_stats), snap->stats_gen,
+				args->since);
+	}
+
+	return dsl_add_cached_reply(bb, channel ? &replies[num].channel_stats[args->type] :
+			&replies[num].line_stats[args->type], snap->stats_gen, snap, args->type,
+			channel ? dsl_channel_stats_serialize : dsl_line_stats_serialize, args->since, &args->fields);
+}
+
+static int dsl_status_all_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	const struct dsl_snapshot *snap;
+	bool changed = false;
+	int i, max_line;
+	void *array_line, *array_chan, *table_line, *table_chan;
+
+	// Initialize the buffer
+	blob_buf_init(&reply_bb, 0);
+
+	array_line = blobmsg_open_array(&reply_bb, DSL_OBJECT_LINE);
+	for (i = 0, max_line = dsl_get_line_number(); i < max_line; i++) {
+		snap = dsl_cache_peek_status(i);
+		if (!snap)
+			return UBUS_STATUS_UNKNOWN_ERROR;
+
+		// Line table
+		table_line = blobmsg_open_table(&reply_bb, "");
+
+		// Line parameters
+		blobmsg_add_u32(&reply_bb, "id", (unsigned int)i);
+		changed |= dsl_add_status_reply(&reply_bb, i, snap, false, args);
+
+		// Embed channel(s) inside a line in the format channel: [{},{}...]
+		array_chan = blobmsg_open_array(&reply_bb, DSL_OBJECT_CHANNEL);
+		table_chan = blobmsg_open_table(&reply_bb, "");
+		// Channel parameters
+		blobmsg_add_u32(&reply_bb, "id", 0);
+		changed |= dsl_add_status_reply(&reply_bb, i, snap, true, args);
+		blobmsg_close_table(&reply_bb, table_chan);
+		blobmsg_close_array(&reply_bb, array_chan);
+
+		blobmsg_add_u32(&reply_bb, DSL_SNAPSHOT_AGE, dsl_snapshot_age(&snap->status_ts));
+		blobmsg_close_table(&reply_bb, table_line);
+	}
+	blobmsg_close_array(&reply_bb, array_line);
+	dsl_add_reply_trailer(&reply_bb, args->since, changed);
+
+	// Send the reply
+	dsl_send_reply(ctx, req);
+
+	return UBUS_STATUS_OK;
+}
+
+static int dsl_status_all(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+	struct dsl_request args = {
+		.num = -1, .reply = dsl_status_all_reply,
+		.method = DSL_DEBUG_STATUS
+	};
+
+	if (dsl_parse_status_args(msg, &args.since, &args.fields, &args.binary) != 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	return dsl_handle_request(ctx, req, &args);
+}
+
+static int dsl_stats_all_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	const struct dsl_snapshot *snap;
+	bool changed = false;
+	int i, max_line;
+	void *array_line, *array_chan, *table_line, *table_chan;
+
+	// Initialize the buffer
+	blob_buf_init(&reply_bb, 0);
+
+	array_line = blobmsg_open_array(&reply_bb, DSL_OBJECT_LINE);
+	for (i = 0, max_line = dsl_get_line_number(); i < max_line; i++) {
+		snap = dsl_cache_peek_stats(i);
+		if (!snap)
+			return UBUS_STATUS_UNKNOWN_ERROR;
+
+		// Line table
+		table_line = blobmsg_open_table(&reply_bb, "");
+
+		// Line statistics including all interval statistics
+		blobmsg_add_u32(&reply_bb, "id", (unsigned int)i);
+		changed |= dsl_add_stats_reply(&reply_bb, i, snap, false, args);
+
+		// Embed channel(s) inside a line in the format channel: [{},{}...]
+		array_chan = blobmsg_open_array(&reply_bb, DSL_OBJECT_CHANNEL);
+		table_chan = blobmsg_open_table(&reply_bb, "");
+
+		// Channel statistics including all interval statistics
+		blobmsg_add_u32(&reply_bb, "id", 0);
+		changed |= dsl_add_stats_reply(&reply_bb, i, snap, true, args);
+
+		// Close the tables and arrays for the channel
+		blobmsg_close_table(&reply_bb, table_chan);
+		blobmsg_close_array(&reply_bb, array_chan);
+
+		// Close the table for one line
+		blobmsg_add_u32(&reply_bb, DSL_SNAPSHOT_AGE, dsl_snapshot_age(&snap->stats_ts));
+		blobmsg_close_table(&reply_bb, table_line);
+	}
+	blobmsg_close_array(&reply_bb, array_line);
+	dsl_add_reply_trailer(&reply_bb, args->since, changed);
+
+	// Send the reply
+	dsl_send_reply(ctx, req);
+
+	return UBUS_STATUS_OK;
+}
+
+static int dsl_stats_all(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+	struct dsl_request args = {
+		.num = -1, .stats = true, .reply = dsl_stats_all_reply,
+		.method = DSL_DEBUG_STATS
+	};
+
+	if (dsl_parse_stats_args(msg, &args.type, &args.since, &args.fields, &args.binary) != 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	return dsl_handle_request(ctx, req, &args);
+}
+
+static struct ubus_method dsl_main_methods[] = {
+	UBUS_METHOD("status", dsl_status_all, dsl_status_policy),
+	UBUS_METHOD("stats", dsl_stats_all, dsl_stats_policy)
+};
+
+static struct ubus_object_type dsl_main_type = UBUS_OBJECT_TYPE("dsl", dsl_main_methods);
+
+static struct ubus_object dsl_main_object = {
+	.name = "dsl",
+	.type = &dsl_main_type,
+	.methods = dsl_main_methods,
+	.n_methods = ARRAY_SIZE(dsl_main_methods),
+};
+
+enum {
+	DSL_DEBUG_ARG_METHOD,
+	DSL_DEBUG_ARG_RESET,
+	__DSL_DEBUG_ARG_MAX,
+};
+
+static const struct blobmsg_policy dsl_debug_policy[__DSL_DEBUG_ARG_MAX] = {
+	[DSL_DEBUG_ARG_METHOD] = { .name = "method", .type = BLOBMSG_TYPE_STRING },
+	[DSL_DEBUG_ARG_RESET] = { .name = "reset", .type = BLOBMSG_TYPE_BOOL },
+};
+
+/* Parses the arguments of dsl.debug, the method being -1 for all methods */
+static int dsl_parse_debug_args(struct blob_attr *msg, int *method, bool *reset)
+{
+	struct blob_attr *tb[__DSL_DEBUG_ARG_MAX];
+
+	blobmsg_parse(dsl_debug_policy, __DSL_DEBUG_ARG_MAX, tb, blob_data(msg), blob_len(msg));
+
+	*method = -1;
+	if (tb[DSL_DEBUG_ARG_METHOD]) {
+		*method = dsl_debug_method(blobmsg_data(tb[DSL_DEBUG_ARG_METHOD]));
+		if (*method < 0) {
+			DSLMNGR_LOG(LOG_ERR, "Wrong argument for method\n");
+			return -1;
+		}
+	}
+	*reset = tb[DSL_DEBUG_ARG_RESET] && blobmsg_get_bool(tb[DSL_DEBUG_ARG_RESET]);
+
+	return 0;
+}
+
+/**
+ * This function replies with the latencies of the methods, and clears them afterwards if "reset"
+ * is true so that successive calls return the latencies of disjoint periods.
+ */
+static int dsl_debug_latency(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+	int debug_method;
+	bool reset;
 
-	// allowed_profiles
-	array = blobmsg_open_array(bb, "allowed_profiles");
-	for (opt = (unsigned long)VDSL2_8a; opt <= (unsigned long)VDSL2_35b; opt <<= 1) {
-		if (line->allowed_profiles & opt)
-			blobmsg_add_string(bb, "", dsl_profile_str(opt));
-	}
-	blobmsg_close_array(bb, array);
+	if (dsl_parse_debug_args(msg, &debug_method, &reset) != 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
 
-	blobmsg_add_u32(bb, "success_failure_cause", line->success_failure_cause);
+	blob_buf_init(&reply_bb, 0);
+	blobmsg_add_string(&reply_bb, "unit", "us");
+	dsl_debug_to_blob(debug_method, &reply_bb);
+	ubus_send_reply(ctx, req, reply_bb.head);
 
-	// upbokler_pb
-	dsl_add_sequence_to_blob("upbokler_pb", false, line->upbokler_pb.count,
-			(const long *)line->upbokler_pb.array, bb);
+	if (reset)
+		dsl_debug_reset(debug_method);
 
-	// rxthrsh_ds
-	dsl_add_sequence_to_blob("rxthrsh_ds", false, line->rxthrsh_ds.count,
-			(const long *)line->rxthrsh_ds.array, bb);
+	return UBUS_STATUS_OK;
+}
 
-	// act_ra_mode
-	unsigned long ra_modes[] = { line->act_ra_mode.us, line->act_ra_mode.ds };
-	dsl_add_usds_to_blob("act_ra_mode", false, ra_modes, bb);
+static int dsl_debug_reset_latency(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+	int debug_method;
+	bool reset;
 
-	blobmsg_add_u64(bb, "snr_mroc_us", line->snr_mroc_us);
+	if (dsl_parse_debug_args(msg, &debug_method, &reset) != 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
 
-	// last_state_transmitted
-	unsigned long lst[] = { line->last_state_transmitted.us, line->last_state_transmitted.ds };
-	dsl_add_usds_to_blob("last_state_transmitted", false, lst, bb);
+	dsl_debug_reset(debug_method);
 
-	// us0_mask
-	blobmsg_add_u64(bb, "us0_mask", line->us0_mask);
+	return UBUS_STATUS_OK;
+}
 
-	// trellis
-	long trellis[] = { line->trellis.us, line->trellis.ds };
-	dsl_add_usds_to_blob("trellis", true, trellis, bb);
+enum {
+	DSL_BACKEND_ARG_SLOW,
+	DSL_BACKEND_ARG_RESET,
+	__DSL_BACKEND_ARG_MAX,
+};
 
-	// act_snr_mode
-	unsigned long snr_modes[] = { line->act_snr_mode.us, line->act_snr_mode.ds };
-	dsl_add_usds_to_blob("act_snr_mode", false, snr_modes, bb);
+static const struct blobmsg_policy dsl_backend_policy[__DSL_BACKEND_ARG_MAX] = {
+	[DSL_BACKEND_ARG_SLOW] = { .name = "slow", .type = BLOBMSG_TYPE_INT32 },
+	[DSL_BACKEND_ARG_RESET] = { .name = "reset", .type = BLOBMSG_TYPE_BOOL },
+};
 
-	// line_number
-	dsl_add_int_to_blob("line_number", line->line_number, bb);
+static void dsl_call_stats_to_blob(struct blob_buf *bb)
+{
+	struct dsl_call_stats stats[64];
+	struct dsl_slow_call slow[DSL_SLOW_CALLS_MAX];
+	void *table, *call, *array;
+	int i, num;
+
+	num = dsl_get_call_stats(stats, ARRAY_SIZE(stats));
+	if (num > ARRAY_SIZE(stats))
+		num = ARRAY_SIZE(stats);
+
+	table = blobmsg_open_table(bb, "calls");
+	for (i = 0; i < num; i++) {
+		call = blobmsg_open_table(bb, stats[i].name);
+		blobmsg_add_u32(bb, "count", stats[i].calls);
+		blobmsg_add_u32(bb, "errors", stats[i].errors);
+		blobmsg_add_u32(bb, "min", stats[i].min_us);
+		blobmsg_add_u32(bb, "avg", stats[i].calls ? (uint32_t)(stats[i].total_us / stats[i].calls) : 0);
+		blobmsg_add_u32(bb, "max", stats[i].max_us);
+		blobmsg_close_table(bb, call);
+	}
+	blobmsg_close_table(bb, table);
 
-	// noise_margin
-	long margins[] = { line->noise_margin.us, line->noise_margin.ds };
-	dsl_add_usds_to_blob("noise_margin", true, margins, bb);
+	num = dsl_get_slow_calls(slow, ARRAY_SIZE(slow));
+	array = blobmsg_open_array(bb, "slow_calls");
+	for (i = 0; i < num; i++) {
+		table = blobmsg_open_table(bb, NULL);
+		blobmsg_add_string(bb, "function", slow[i].name);
+		blobmsg_add_string(bb, "args", slow[i].args);
+		blobmsg_add_u32(bb, "latency", slow[i].latency_us);
+		blobmsg_add_u8(bb, "failed", slow[i].failed);
+		blobmsg_add_u64(bb, "time", (uint64_t)slow[i].time);
+		blobmsg_close_table(bb, table);
+	}
+	blobmsg_close_array(bb, array);
+}
 
-	// snr_mpb_us
-	dsl_add_sequence_to_blob("snr_mpb_us", true, line->snr_mpb_us.count,
-			(const long *)line->snr_mpb_us.array, bb);
+/**
+ * This function replies with the counters of the calls into libdsl and the last slow calls. The
+ * argument "slow" sets the latency in microseconds from which a call is kept as a slow one, 0
+ * disabling it, and "reset" clears the counters and the slow calls once returned.
+ */
+static int dsl_debug_backend(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+	struct blob_attr *tb[__DSL_BACKEND_ARG_MAX];
 
-	// snr_mpb_ds
-	dsl_add_sequence_to_blob("snr_mpb_ds", true, line->snr_mpb_ds.count,
-			(const long *)line->snr_mpb_ds.array, bb);
+	blobmsg_parse(dsl_backend_policy, __DSL_BACKEND_ARG_MAX, tb, blob_data(msg), blob_len(msg));
 
-	// attenuation
-	long attenuations[] = { line->attenuation.us, line->attenuation.ds };
-	dsl_add_usds_to_blob("attenuation", true, attenuations, bb);
+	if (tb[DSL_BACKEND_ARG_SLOW])
+		dsl_set_slow_call_threshold(blobmsg_get_u32(tb[DSL_BACKEND_ARG_SLOW]));
 
-	// power
-	long powers[] = { line->power.us, line->power.ds };
-	dsl_add_usds_to_blob("power", true, powers, bb);
+	blob_buf_init(&reply_bb, 0);
+	blobmsg_add_string(&reply_bb, "unit", "us");
+	dsl_call_stats_to_blob(&reply_bb);
+	ubus_send_reply(ctx, req, reply_bb.head);
 
-	blobmsg_add_string(bb, "xtur_vendor", line->xtur_vendor);
-	blobmsg_add_string(bb, "xtur_country", line->xtur_country);
-	blobmsg_add_u64(bb, "xtur_ansi_std", line->xtur_ansi_std);
-	blobmsg_add_u64(bb, "xtur_ansi_rev", line->xtur_ansi_rev);
+	if (tb[DSL_BACKEND_ARG_RESET] && blobmsg_get_bool(tb[DSL_BACKEND_ARG_RESET]))
+		dsl_reset_call_stats();
 
-	blobmsg_add_string(bb, "xtuc_vendor", line->xtuc_vendor);
-	blobmsg_add_string(bb, "xtuc_country", line->xtuc_country);
-	blobmsg_add_u64(bb, "xtuc_ansi_std", line->xtuc_ansi_std);
-	blobmsg_add_u64(bb, "xtuc_ansi_rev", line->xtuc_ansi_rev);
+	return UBUS_STATUS_OK;
 }
 
-static const char *dsl_link_encap_str(enum dsl_link_encapsulation encap)
+/* Times since the start of dslmngr, 0 for those not reached yet */
+static int dsl_debug_startup(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
-	switch (encap) {
-	case G_992_3_ANNEK_K_ATM: return "adsl2_atm";
-	case G_992_3_ANNEK_K_PTM: return "adsl2_ptm";
-	case G_993_2_ANNEK_K_ATM: return "vdsl2_atm";
-	case G_993_2_ANNEK_K_PTM: return "vdsl2_ptm";
-	case G_994_1_AUTO: return "auto";
-	default: return "unknown";
-	}
+	blob_buf_init(&reply_bb, 0);
+	blobmsg_add_string(&reply_bb, "unit", "us");
+	blobmsg_add_u8(&reply_bb, "ready", dslmngr_startup.ready);
+	blobmsg_add_u64(&reply_bb, "ubus_ready", dslmngr_startup.ubus_ready);
+	blobmsg_add_u64(&reply_bb, "probed", dslmngr_startup.probed);
+	blobmsg_add_u64(&reply_bb, "lines_ready", dslmngr_startup.lines_ready);
+	ubus_send_reply(ctx, req, reply_bb.head);
+
+	return UBUS_STATUS_OK;
+}
+
+static struct ubus_method dsl_debug_methods[] = {
+	UBUS_METHOD("latency", dsl_debug_latency, dsl_debug_policy),
+	UBUS_METHOD("reset", dsl_debug_reset_latency, dsl_debug_policy),
+	UBUS_METHOD("backend", dsl_debug_backend, dsl_backend_policy),
+	UBUS_METHOD_NOARG("startup", dsl_debug_startup)
 };
 
-static void dsl_status_channel_to_blob(const struct dsl_channel *channel, struct blob_buf *bb)
-{
-	void *array;
-	unsigned long opt;
+static struct ubus_object_type dsl_debug_type = UBUS_OBJECT_TYPE("dsl.debug", dsl_debug_methods);
 
-	blobmsg_add_string(bb, "status", dsl_if_status_str(channel->status));
-	blobmsg_add_string(bb, "link_encapsulation_used", dsl_link_encap_str(channel->link_encapsulation_used));
+static struct ubus_object dsl_debug_object = {
+	.name = "dsl.debug",
+	.type = &dsl_debug_type,
+	.methods = dsl_debug_methods,
+	.n_methods = ARRAY_SIZE(dsl_debug_methods),
+};
 
-	// curr_rate
-	unsigned long curr_rates[] = { channel->curr_rate.us, channel->curr_rate.ds };
-	dsl_add_usds_to_blob("curr_rate", false, curr_rates, bb);
+static int dsl_line_status_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	const struct dsl_snapshot *snap;
+	bool changed;
 
-	// actndr
-	unsigned long act_rates[] = { channel->actndr.us, channel->actndr.ds };
-	dsl_add_usds_to_blob("actndr", false, act_rates, bb);
+	snap = dsl_cache_peek_status(args->num);
+	if (!snap)
+		return UBUS_STATUS_UNKNOWN_ERROR;
 
-	// link_encapsulation_supported
-	array = blobmsg_open_array(bb, "link_encapsulation_supported");
-	for (opt = (unsigned long)G_992_3_ANNEK_K_ATM; opt <= (unsigned long)G_994_1_AUTO; opt <<= 1) {
-		if (channel->link_encapsulation_supported & opt)
-			blobmsg_add_string(bb, "", dsl_link_encap_str(opt));
-	}
-	blobmsg_close_array(bb, array);
+	blob_buf_init(&reply_bb, 0);
+	changed = dsl_add_status_reply(&reply_bb, args->num, snap, false, args);
+	blobmsg_add_u32(&reply_bb, DSL_SNAPSHOT_AGE, dsl_snapshot_age(&snap->status_ts));
+	dsl_add_reply_trailer(&reply_bb, args->since, changed);
 
-	blobmsg_add_u64(bb, "lpath", channel->lpath);
-	blobmsg_add_u64(bb, "intlvdepth", channel->intlvdepth);
-	dsl_add_int_to_blob("intlvblock", channel->intlvblock, bb);
-	blobmsg_add_u64(bb, "actual_interleaving_delay", channel->actual_interleaving_delay);
-	dsl_add_int_to_blob("actinp", channel->actinp, bb);
-	blobmsg_add_u8(bb, "inpreport", channel->inpreport);
-	dsl_add_int_to_blob("nfec", channel->nfec, bb);
-	dsl_add_int_to_blob("rfec", channel->rfec, bb);
-	dsl_add_int_to_blob("lsymb", channel->lsymb, bb);
+	// Send the reply
+	dsl_send_reply(ctx, req);
 
-	// actinprein
-	unsigned long act_inps[] = { channel->actinprein.us, channel->actinprein.ds };
-	dsl_add_usds_to_blob("actinprein", false, act_inps, bb);
+	return UBUS_STATUS_OK;
 }
 
-static int dsl_status_all(struct ubus_context *ctx, struct ubus_object *obj,
+static int dsl_line_status(struct ubus_context *ctx, struct ubus_object *obj,
 		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
-	static struct blob_buf bb;
-	struct dsl_line line;
-	struct dsl_channel channel;
-	int retval = UBUS_STATUS_OK;
-	int i, max_line;
-	void *array_line, *array_chan, *table_line, *table_chan;
+	struct dsl_request args = {
+		.num = -1, .reply = dsl_line_status_reply,
+		.method = DSL_DEBUG_LINE_STATUS
+	};
 
-	// Initialize the buffer
-	memset(&bb, 0, sizeof(bb));
-	blob_buf_init(&bb, 0);
+	if (dsl_parse_status_args(msg, &args.since, &args.fields, &args.binary) != 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
 
-	array_line = blobmsg_open_array(&bb, DSL_OBJECT_LINE);
-	for (i = 0, max_line = dsl_get_line_number(); i < max_line; i++) {
-		if (xdsl_ops.get_line_info == NULL || (*xdsl_ops.get_line_info)(i, &line) != 0 ||
-			xdsl_ops.get_channel_info == NULL || (*xdsl_ops.get_channel_info)(i, &channel) != 0) {
-			retval = UBUS_STATUS_UNKNOWN_ERROR;
-			goto __ret;
-		}
+	// Get line status
+	if (sscanf(obj->name, "dsl.line.%d", &args.num) != 1 || args.num < 0)
+		return UBUS_STATUS_UNKNOWN_ERROR;
 
-		// Line table
-		table_line = blobmsg_open_table(&bb, "");
+	return dsl_handle_request(ctx, req, &args);
+}
 
-		// Line parameters
-		blobmsg_add_u32(&bb, "id", (unsigned int)i);
-		dsl_status_line_to_blob(&line, &bb);
+static int dsl_line_stats_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	const struct dsl_snapshot *snap;
+	bool changed;
 
-		// Embed channel(s) inside a line in the format channel: [{},{}...]
-		array_chan = blobmsg_open_array(&bb, DSL_OBJECT_CHANNEL);
-		table_chan = blobmsg_open_table(&bb, "");
-		// Channel parameters
-		blobmsg_add_u32(&bb, "id", 0);
-		dsl_status_channel_to_blob(&channel, &bb);
-		blobmsg_close_table(&bb, table_chan);
-		blobmsg_close_array(&bb, array_chan);
+	snap = dsl_cache_peek_stats(args->num);
+	if (!snap)
+		return UBUS_STATUS_UNKNOWN_ERROR;
 
-		blobmsg_close_table(&bb, table_line);
-	}
-	blobmsg_close_array(&bb, array_line);
+	blob_buf_init(&reply_bb, 0);
+	changed = dsl_add_stats_reply(&reply_bb, args->num, snap, false, args);
+	blobmsg_add_u32(&reply_bb, DSL_SNAPSHOT_AGE, dsl_snapshot_age(&snap->stats_ts));
+	dsl_add_reply_trailer(&reply_bb, args->since, changed);
 
 	// Send the reply
-	ubus_send_reply(ctx, req, bb.head);
+	dsl_send_reply(ctx, req);
 
-__ret:
-	blob_buf_free(&bb);
-	return retval;
+	return UBUS_STATUS_OK;
 }
 
-static struct value2text dsl_stats_types[] = {
-	{ DSL_STATS_TOTAL, "total" },
-	{ DSL_STATS_SHOWTIME, "showtime" },
-	{ DSL_STATS_LASTSHOWTIME, "lastshowtime" },
-	{ DSL_STATS_CURRENTDAY, "currentday" },
-	{ DSL_STATS_QUARTERHOUR, "quarterhour" }
-};
-
-static void dsl_stats_to_blob(const struct dsl_line_channel_stats *stats, struct blob_buf *bb)
+static int dsl_line_stats(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
-	blobmsg_add_u64(bb, "total_start", stats->total_start);
-	blobmsg_add_u64(bb, "showtime_start", stats->showtime_start);
-	blobmsg_add_u64(bb, "last_showtime_start", stats->last_showtime_start);
-	blobmsg_add_u64(bb, "current_day_start", stats->current_day_start);
-	blobmsg_add_u64(bb, "quarter_hour_start", stats->quarter_hour_start);
+	struct dsl_request args = {
+		.num = -1, .stats = true, .reply = dsl_line_stats_reply,
+		.method = DSL_DEBUG_LINE_STATS
+	};
+
+	if (dsl_parse_stats_args(msg, &args.type, &args.since, &args.fields, &args.binary) != 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	// Get line statistics, either of one interval or all of them
+	if (sscanf(obj->name, "dsl.line.%d", &args.num) != 1 || args.num < 0)
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	return dsl_handle_request(ctx, req, &args);
 }
 
-static void dsl_stats_line_interval_to_blob(const struct dsl_line_stats_interval *stats, struct blob_buf *bb)
+/* Default period in seconds of the telemetry notifications */
+#define DSL_TELEMETRY_PERIOD 10
+
+/**
+ * struct dsl_object - UBUS object of a line or a channel
+ *
+ * While the object has subscribers, its status and statistics are sent to all of them in one
+ * "telemetry" notification every period seconds.
+ */
+struct dsl_object {
+	struct ubus_object obj;
+	int num;
+	bool channel;
+	unsigned int period;
+	struct uloop_timeout timer;
+	struct dsl_cache_waiter waiter;
+	bool pending;
+};
+
+/* Context on which the notifications are sent */
+static struct ubus_context *dsl_ctx;
+
+/* The notifications are built in this buffer, once for all subscribers of an object */
+static struct blob_buf notify_bb;
+
+static void dsl_telemetry_send(struct dsl_object *dobj)
 {
-	blobmsg_add_u64(bb, "errored_secs", stats->errored_secs);
-	blobmsg_add_u64(bb, "severely_errored_secs", stats->severely_errored_secs);
+	const struct dsl_snapshot *status = dsl_cache_peek_status(dobj->num);
+	const struct dsl_snapshot *stats = dsl_cache_peek_stats(dobj->num);
+	struct dsl_line_replies *rep = &replies[dobj->num];
+	void *table;
+
+	blob_buf_init(&notify_bb, 0);
+
+	// The cached replies are reused, the data are only serialized again if they have changed
+	if (status) {
+		table = blobmsg_open_table(&notify_bb, "status");
+		if (dobj->channel)
+			dsl_add_cached_reply(&notify_bb, &rep->channel_status, status->status_gen, status, 0,
+					dsl_channel_status_serialize, 0, NULL);
+		else
+			dsl_add_cached_reply(&notify_bb, &rep->line_status, status->status_gen, status, 0,
+					dsl_line_status_serialize, 0, NULL);
+		blobmsg_close_table(&notify_bb, table);
+	}
+
+	if (stats) {
+		table = blobmsg_open_table(&notify_bb, "stats");
+		if (dobj->channel)
+			dsl_add_cached_reply(&notify_bb, &rep->channel_stats[0], stats->stats_gen, stats, 0,
+					dsl_channel_stats_serialize, 0, NULL);
+		else
+			dsl_add_cached_reply(&notify_bb, &rep->line_stats[0], stats->stats_gen, stats, 0,
+					dsl_line_stats_serialize, 0, NULL);
+		blobmsg_close_table(&notify_bb, table);
+		blobmsg_add_u32(&notify_bb, DSL_SNAPSHOT_AGE, dsl_snapshot_age(&stats->stats_ts));
+	}
+	blobmsg_add_u32(&notify_bb, DSL_GENERATION, dsl_cache_generation());
+
+	// One message for all subscribers
+	ubus_notify(dsl_ctx, &dobj->obj, "telemetry", notify_bb.head, -1);
 }
 
-static void dsl_stats_channel_interval_to_blob(const struct dsl_channel_stats_interval *stats, struct blob_buf *bb)
+static void dsl_telemetry_waiter_cb(struct dsl_cache_waiter *waiter)
 {
-	blobmsg_add_u64(bb, "xtur_fec_errors", stats->xtur_fec_errors);
-	blobmsg_add_u64(bb, "xtuc_fec_errors", stats->xtuc_fec_errors);
-	blobmsg_add_u64(bb, "xtur_hec_errors", stats->xtur_hec_errors);
-	blobmsg_add_u64(bb, "xtuc_hec_errors", stats->xtuc_hec_errors);
-	blobmsg_add_u64(bb, "xtur_crc_errors", stats->xtur_crc_errors);
-	blobmsg_add_u64(bb, "xtuc_crc_errors", stats->xtuc_crc_errors);
+	struct dsl_object *dobj = container_of(waiter, struct dsl_object, waiter);
+
+	dobj->pending = false;
+	if (dobj->obj.has_subscribers)
+		dsl_telemetry_send(dobj);
 }
 
-static int dsl_stats_all(struct ubus_context *ctx, struct ubus_object *obj,
-		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+static void dsl_telemetry_timer_cb(struct uloop_timeout *t)
 {
-	int retval = UBUS_STATUS_OK;
-	static struct blob_buf bb;
-	enum dsl_stats_type type;
-	struct dsl_line_channel_stats stats;
-	struct dsl_line_stats_interval line_stats_interval;
-	struct dsl_channel_stats_interval channel_stats_interval;
-	int i, j, max_line;
-	void *array_line, *array_chan, *table_line, *table_interval, *table_chan;
-
-	// Initialize the buffer
-	memset(&bb, 0, sizeof(bb));
-	blob_buf_init(&bb, 0);
+	struct dsl_object *dobj = container_of(t, struct dsl_object, timer);
+
+	if (!dobj->obj.has_subscribers)
+		return;
+	uloop_timeout_set(t, dobj->period * 1000);
+
+	// The previous notification is still waiting for the backend
+	if (dobj->pending)
+		return;
+
+	switch (dsl_cache_refresh_async(&dobj->waiter, dobj->num, true, true)) {
+	case 0:
+		dobj->pending = true;
+		return;
+	case -1:
+		dsl_cache_refresh(dobj->num, true, true);
+		break;
+	default:
+		break;
+	}
 
-	array_line = blobmsg_open_array(&bb, DSL_OBJECT_LINE);
-	for (i = 0, max_line = dsl_get_line_number(); i < max_line; i++) {
-		if (xdsl_ops.get_line_stats == NULL || (*xdsl_ops.get_line_stats)(i, &stats) != 0) {
-			retval = UBUS_STATUS_UNKNOWN_ERROR;
-			goto __ret;
-		}
+	dsl_telemetry_send(dobj);
+}
 
-		// Line table
-		table_line = blobmsg_open_table(&bb, "");
+static void dsl_telemetry_subscribe_cb(struct ubus_context *ctx, struct ubus_object *obj)
+{
+	struct dsl_object *dobj = container_of(obj, struct dsl_object, obj);
 
-		// Line statistics
-		blobmsg_add_u32(&bb, "id", (unsigned int)i);
-		dsl_stats_to_blob(&stats, &bb);
+	if (obj->has_subscribers) {
+		if (!dobj->timer.pending)
+			uloop_timeout_set(&dobj->timer, 0);
+	} else {
+		// The next subscribers start again from the default period
+		uloop_timeout_cancel(&dobj->timer);
+		dobj->period = DSL_TELEMETRY_PERIOD;
+	}
+}
 
-		// Line interval statistics
-		for (j = 0; j < ARRAY_SIZE(dsl_stats_types); j++) {
-			table_interval = blobmsg_open_table(&bb, dsl_stats_types[j].text);
+enum {
+	DSL_TELEMETRY_PERIOD_ARG,
+	__DSL_TELEMETRY_MAX,
+};
 
-			if (xdsl_ops.get_line_stats_interval == NULL || (*xdsl_ops.get_line_stats_interval)
-				(i, dsl_stats_types[j].value, &line_stats_interval) != 0) {
-				retval = UBUS_STATUS_UNKNOWN_ERROR;
-				goto __ret;
-			}
-			dsl_stats_line_interval_to_blob(&line_stats_interval, &bb);
+static const struct blobmsg_policy dsl_telemetry_policy[__DSL_TELEMETRY_MAX] = {
+	[DSL_TELEMETRY_PERIOD_ARG] = { .name = "period", .type = BLOBMSG_TYPE_INT32 },
+};
 
-			blobmsg_close_table(&bb, table_interval);
-		}
+/**
+ * This function sets the period of the telemetry notifications of an object, which is shared by
+ * all of its subscribers, and replies with the period in use.
+ */
+static int dsl_telemetry(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+	struct dsl_object *dobj = container_of(obj, struct dsl_object, obj);
+	struct blob_attr *tb[__DSL_TELEMETRY_MAX];
+	uint32_t period;
+
+	dsl_reply_begin(dobj->channel ? DSL_DEBUG_CHANNEL_TELEMETRY : DSL_DEBUG_LINE_TELEMETRY);
+	blobmsg_parse(dsl_telemetry_policy, __DSL_TELEMETRY_MAX, tb, blob_data(msg), blob_len(msg));
+	if (tb[DSL_TELEMETRY_PERIOD_ARG]) {
+		period = blobmsg_get_u32(tb[DSL_TELEMETRY_PERIOD_ARG]);
+		if (period == 0 || period > DSL_PERIOD_MAX)
+			return UBUS_STATUS_INVALID_ARGUMENT;
 
-		// Embed channel(s) inside a line in the format channel: [{},{}...]
-		array_chan = blobmsg_open_array(&bb, DSL_OBJECT_CHANNEL);
-		table_chan = blobmsg_open_table(&bb, "");
-
-		// Channel statistics
-		blobmsg_add_u32(&bb, "id", 0);
-		if (xdsl_ops.get_channel_stats == NULL || (*xdsl_ops.get_channel_stats)(i, &stats) != 0) {
-			retval = UBUS_STATUS_UNKNOWN_ERROR;
-			goto __ret;
-		}
-		dsl_stats_to_blob(&stats, &bb);
+		dobj->period = period;
+		if (obj->has_subscribers)
+			uloop_timeout_set(&dobj->timer, period * 1000);
+	}
 
-		// Line interval statistics
-		for (j = 0; j < ARRAY_SIZE(dsl_stats_types); j++) {
-			table_interval = blobmsg_open_table(&bb, dsl_stats_types[j].text);
+	blob_buf_init(&reply_bb, 0);
+	blobmsg_add_u32(&reply_bb, "period", dobj->period);
+	blobmsg_add_u8(&reply_bb, "subscribed", obj->has_subscribers);
+	dsl_send_reply(ctx, req);
 
-			if (xdsl_ops.get_channel_stats_interval == NULL || (*xdsl_ops.get_channel_stats_interval)
-				(i, dsl_stats_types[j].value, &channel_stats_interval) != 0) {
-				retval = UBUS_STATUS_UNKNOWN_ERROR;
-				goto __ret;
-			}
-			dsl_stats_channel_interval_to_blob(&channel_stats_interval, &bb);
+	return UBUS_STATUS_OK;
+}
 
-			blobmsg_close_table(&bb, table_interval);
-		}
+static int dsl_rates_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args, bool channel)
+{
+	const struct dsl_snapshot *snap;
 
-		// Close the tables and arrays for the channel
-		blobmsg_close_table(&bb, table_chan);
-		blobmsg_close_array(&bb, array_chan);
+	snap = dsl_cache_peek_stats(args->num);
+	if (!snap)
+		return UBUS_STATUS_UNKNOWN_ERROR;
 
-		// Close the table for one line
-		blobmsg_close_table(&bb, table_line);
-	}
-	blobmsg_close_array(&bb, array_line);
+	blob_buf_init(&reply_bb, 0);
+	if (dsl_rates_to_blob(&snap->rates, channel, &reply_bb) != 0)
+		return UBUS_STATUS_NO_DATA;
+	blobmsg_add_u32(&reply_bb, DSL_SNAPSHOT_AGE, dsl_snapshot_age(&snap->stats_ts));
 
 	// Send the reply
-	ubus_send_reply(ctx, req, bb.head);
-
-__ret:
-	blob_buf_free(&bb);
+	dsl_send_reply(ctx, req);
 
-	return retval;
+	return UBUS_STATUS_OK;
 }
 
-static struct ubus_method dsl_main_methods[] = {
-	{ .name = "status", .handler = dsl_status_all },
-	{ .name = "stats", .handler = dsl_stats_all }
-};
-
-static struct ubus_object_type dsl_main_type = UBUS_OBJECT_TYPE("dsl", dsl_main_methods);
-
-static struct ubus_object dsl_main_object = {
-	.name = "dsl",
-	.type = &dsl_main_type,
-	.methods = dsl_main_methods,
-	.n_methods = ARRAY_SIZE(dsl_main_methods),
-};
+static int dsl_line_rates_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	return dsl_rates_reply(ctx, req, args, false);
+}
 
-static int dsl_line_status(struct ubus_context *ctx, struct ubus_object *obj,
+static int dsl_line_rates(struct ubus_context *ctx, struct ubus_object *obj,
 		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
-	static struct blob_buf bb;
-	struct dsl_line line;
-	int retval = UBUS_STATUS_OK;
-	int num = -1;
+	struct dsl_request args = {
+		.num = -1, .stats = true, .reply = dsl_line_rates_reply,
+		.method = DSL_DEBUG_LINE_RATES
+	};
 
-	// Initialize the buffer
-	memset(&bb, 0, sizeof(bb));
-	blob_buf_init(&bb, 0);
+	if (sscanf(obj->name, "dsl.line.%d", &args.num) != 1 || args.num < 0)
+		return UBUS_STATUS_UNKNOWN_ERROR;
 
-	// Get line status
-	sscanf(obj->name, "dsl.line.%d", &num);
-	if (xdsl_ops.get_line_info == NULL || (*xdsl_ops.get_line_info)(num, &line) != 0) {
-		retval = UBUS_STATUS_UNKNOWN_ERROR;
-		goto __ret;
+	// The statistics are read if they are older than the cache TTL, which updates the rates
+	return dsl_handle_request(ctx, req, &args);
+}
+
+/**
+ * This function replies with the recorded values of a line or channel metric. The history is kept
+ * in memory, so the backend is never called.
+ */
+static int dsl_history(struct ubus_context *ctx, struct ubus_request_data *req, struct blob_attr *msg,
+		int num, bool channel)
+{
+	struct blob_attr *tb[__DSL_HISTORY_MAX];
+	uint32_t start = 0, end = 0;
+
+	dsl_reply_begin(channel ? DSL_DEBUG_CHANNEL_HISTORY : DSL_DEBUG_LINE_HISTORY);
+	if (dslmngr_conf.history_period == 0)
+		return UBUS_STATUS_NOT_SUPPORTED;
+
+	blobmsg_parse(dsl_history_policy, __DSL_HISTORY_MAX, tb, blob_data(msg), blob_len(msg));
+	if (!tb[DSL_HISTORY_FIELD])
+		return UBUS_STATUS_INVALID_ARGUMENT;
+	if (tb[DSL_HISTORY_START])
+		start = blobmsg_get_u32(tb[DSL_HISTORY_START]);
+	if (tb[DSL_HISTORY_END])
+		end = blobmsg_get_u32(tb[DSL_HISTORY_END]);
+
+	blob_buf_init(&reply_bb, 0);
+	if (dsl_history_to_blob(num, blobmsg_data(tb[DSL_HISTORY_FIELD]), channel, start, end, &reply_bb) != 0) {
+		DSLMNGR_LOG(LOG_ERR, "Wrong argument for history field\n");
+		return UBUS_STATUS_INVALID_ARGUMENT;
 	}
-	dsl_status_line_to_blob(&line, &bb);
 
 	// Send the reply
-	ubus_send_reply(ctx, req, bb.head);
+	dsl_send_reply(ctx, req);
 
-__ret:
-	blob_buf_free(&bb);
-	return retval;
+	return UBUS_STATUS_OK;
 }
 
-static int dsl_line_stats(struct ubus_context *ctx, struct ubus_object *obj,
+static int dsl_line_history(struct ubus_context *ctx, struct ubus_object *obj,
 		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
-	static struct blob_buf bb;
-	struct blob_attr *tb[__DSL_STATS_MAX];
-	enum dsl_stats_type type = DSL_STATS_QUARTERHOUR + 1;
-	struct dsl_line_channel_stats stats;
-	struct dsl_line_stats_interval line_stats_interval;
-	int retval = UBUS_STATUS_OK;
 	int num = -1;
-	int i, j;
-	void *table;
 
-	// Parse and validation check the interval type if any
-	blobmsg_parse(dsl_stats_policy, __DSL_STATS_MAX, tb, blob_data(msg), blob_len(msg));
-	if (tb[DSL_STATS_INTERVAL]) {
-		const char *st = blobmsg_data(tb[DSL_STATS_INTERVAL]);
+	if (sscanf(obj->name, "dsl.line.%d", &num) != 1 || num < 0)
+		return UBUS_STATUS_UNKNOWN_ERROR;
 
-		for (i = 0; i < ARRAY_SIZE(dsl_stats_types); i++) {
-			if (strcasecmp(st, dsl_stats_types[i].text) == 0) {
-				type = dsl_stats_types[i].value;
-				break;
-			}
-		}
+	return dsl_history(ctx, req, msg, num, false);
+}
 
-		if (i >= ARRAY_SIZE(dsl_stats_types)) {
-			DSLMNGR_LOG(LOG_ERR, "Wrong argument for interval statistics type\n");
-			return UBUS_STATUS_INVALID_ARGUMENT;
+static int dsl_parse_tones_args(struct blob_attr *msg, struct dsl_tones_request *tones)
+{
+	struct blob_attr *tb[__DSL_TONES_ARG_MAX];
+	const char *str;
+	int type;
+
+	blobmsg_parse(dsl_tones_policy, __DSL_TONES_ARG_MAX, tb, blob_data(msg), blob_len(msg));
+
+	// All types in both directions and for all tones by default
+	tones->types = (1U << __DSL_TONES_MAX) - 1;
+	tones->us = tones->ds = true;
+	tones->start = 0;
+	tones->end = DSL_MAX_TONES - 1;
+	tones->hex = false;
+
+	if (tb[DSL_TONES_ARG_TYPE]) {
+		type = dsl_tones_type(blobmsg_data(tb[DSL_TONES_ARG_TYPE]));
+		if (type < 0) {
+			DSLMNGR_LOG(LOG_ERR, "Wrong argument for per-tone data type\n");
+			return -1;
 		}
+		tones->types = 1U << type;
 	}
 
-	// Initialize the buffer
-	memset(&bb, 0, sizeof(bb));
-	blob_buf_init(&bb, 0);
-
-	// Get line number
-	sscanf(obj->name, "dsl.line.%d", &num);
-
-	// Get line interval statistics
-	if (type >= DSL_STATS_TOTAL && type <= DSL_STATS_QUARTERHOUR) {
-		if (xdsl_ops.get_line_stats_interval == NULL || (*xdsl_ops.get_line_stats_interval)
-			(num, type, &line_stats_interval) != 0) {
-			retval = UBUS_STATUS_UNKNOWN_ERROR;
-			goto __ret;
+	if (tb[DSL_TONES_ARG_DIRECTION]) {
+		str = blobmsg_data(tb[DSL_TONES_ARG_DIRECTION]);
+		tones->us = strcasecmp(str, "us") == 0;
+		tones->ds = strcasecmp(str, "ds") == 0;
+		if (!tones->us && !tones->ds) {
+			DSLMNGR_LOG(LOG_ERR, "Wrong argument for direction\n");
+			return -1;
 		}
-		dsl_stats_line_interval_to_blob(&line_stats_interval, &bb);
-	} else {
-		// Get line statistics
-		if (xdsl_ops.get_line_stats == NULL || (*xdsl_ops.get_line_stats)(num, &stats) != 0) {
-			retval = UBUS_STATUS_UNKNOWN_ERROR;
-			goto __ret;
+	}
+
+	if (tb[DSL_TONES_ARG_START])
+		tones->start = blobmsg_get_u32(tb[DSL_TONES_ARG_START]);
+	if (tb[DSL_TONES_ARG_END])
+		tones->end = blobmsg_get_u32(tb[DSL_TONES_ARG_END]);
+	if (tones->start > tones->end)
+		return -1;
+
+	if (tb[DSL_TONES_ARG_ENCODING]) {
+		str = blobmsg_data(tb[DSL_TONES_ARG_ENCODING]);
+		tones->hex = strcasecmp(str, "hex") == 0;
+		if (!tones->hex && strcasecmp(str, "binary") != 0) {
+			DSLMNGR_LOG(LOG_ERR, "Wrong argument for encoding\n");
+			return -1;
 		}
-		dsl_stats_to_blob(&stats, &bb);
+	}
 
-		// Get all interval statistics
-		for (j = 0; j < ARRAY_SIZE(dsl_stats_types); j++) {
-			table = blobmsg_open_table(&bb, dsl_stats_types[j].text);
+	return 0;
+}
 
-			if (xdsl_ops.get_line_stats_interval == NULL || (*xdsl_ops.get_line_stats_interval)
-				(num, dsl_stats_types[j].value, &line_stats_interval) != 0) {
-				retval = UBUS_STATUS_UNKNOWN_ERROR;
-				goto __ret;
-			}
-			dsl_stats_line_interval_to_blob(&line_stats_interval, &bb);
+static void dsl_line_tones_cb(struct dsl_tones_waiter *waiter)
+{
+	dsl_deferred_request_complete(container_of(waiter, struct dsl_deferred_request, tones_waiter));
+}
 
-			blobmsg_close_table(&bb, table);
+/* Reads the per-tone data which are not cached for the current showtime */
+static bool dsl_line_tones_fetch(const struct dsl_request *args, struct dsl_deferred_request *dr)
+{
+	const struct dsl_snapshot *snap;
+
+	// The statistics tell when the current showtime began, for which the data are cached
+	snap = dsl_cache_peek_stats(args->num);
+	if (!snap)
+		return false;
+
+	if (dr) {
+		dr->tones_waiter.cb = dsl_line_tones_cb;
+		switch (dsl_tones_refresh_async(&dr->tones_waiter, args->num, snap, &args->tones)) {
+		case 0:
+			return true;
+		case 1:
+			return false;
 		}
 	}
 
+	// No worker thread or too many pending requests, call the backend from here
+	dsl_tones_refresh(args->num, snap, &args->tones);
+	return false;
+}
+
+static int dsl_line_tones_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	int ret;
+
+	if (!dsl_cache_peek_stats(args->num))
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	blob_buf_init(&reply_bb, 0);
+	ret = dsl_tones_to_blob(args->num, &args->tones, &reply_bb);
+	if (ret == -2)
+		return UBUS_STATUS_NOT_SUPPORTED;
+	if (ret != 0)
+		return UBUS_STATUS_NO_DATA;
+
 	// Send the reply
-	ubus_send_reply(ctx, req, bb.head);
+	dsl_send_reply(ctx, req);
+
+	return UBUS_STATUS_OK;
+}
+
+static int dsl_line_tones(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+	struct dsl_request args = {
+		.num = -1, .stats = true, .reply = dsl_line_tones_reply,
+		.fetch = dsl_line_tones_fetch, .method = DSL_DEBUG_LINE_TONES
+	};
 
-__ret:
-	blob_buf_free(&bb);
-	return retval;
+	if (dsl_parse_tones_args(msg, &args.tones) != 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
+
+	if (sscanf(obj->name, "dsl.line.%d", &args.num) != 1 || args.num < 0)
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	return dsl_handle_request(ctx, req, &args);
 }
 
 static struct ubus_method dsl_line_methods[] = {
-	{ .name = "status", .handler = dsl_line_status },
-	UBUS_METHOD("stats", dsl_line_stats, dsl_stats_policy )
+	UBUS_METHOD("status", dsl_line_status, dsl_status_policy),
+	UBUS_METHOD("stats", dsl_line_stats, dsl_stats_policy ),
+	UBUS_METHOD("history", dsl_line_history, dsl_history_policy),
+	UBUS_METHOD_NOARG("rates", dsl_line_rates),
+	UBUS_METHOD("telemetry", dsl_telemetry, dsl_telemetry_policy),
+	UBUS_METHOD("tones", dsl_line_tones, dsl_tones_policy)
 };
 
 static struct ubus_object_type dsl_line_type = UBUS_OBJECT_TYPE("dsl.line", dsl_line_methods);
 
+static int dsl_channel_status_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	const struct dsl_snapshot *snap;
+	bool changed;
+
+	snap = dsl_cache_peek_status(args->num);
+	if (!snap)
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	blob_buf_init(&reply_bb, 0);
+	changed = dsl_add_status_reply(&reply_bb, args->num, snap, true, args);
+	blobmsg_add_u32(&reply_bb, DSL_SNAPSHOT_AGE, dsl_snapshot_age(&snap->status_ts));
+	dsl_add_reply_trailer(&reply_bb, args->since, changed);
+
+	// Send the reply
+	dsl_send_reply(ctx, req);
+
+	return UBUS_STATUS_OK;
+}
+
 static int dsl_channel_status(struct ubus_context *ctx, struct ubus_object *obj,
 		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
-	static struct blob_buf bb;
-	struct dsl_channel channel;
-	int retval = UBUS_STATUS_OK;
-	int num = -1;
+	struct dsl_request args = {
+		.num = -1, .reply = dsl_channel_status_reply,
+		.method = DSL_DEBUG_CHANNEL_STATUS
+	};
 
-	// Initialize the buffer
-	memset(&bb, 0, sizeof(bb));
-	blob_buf_init(&bb, 0);
+	if (dsl_parse_status_args(msg, &args.since, &args.fields, &args.binary) != 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
 
 	// Get channel status
-	sscanf(obj->name, "dsl.channel.%d", &num);
-	if (xdsl_ops.get_channel_info == NULL || (*xdsl_ops.get_channel_info)(num, &channel) != 0) {
-		retval = UBUS_STATUS_UNKNOWN_ERROR;
-		goto __ret;
-	}
-	dsl_status_channel_to_blob(&channel, &bb);
+	if (sscanf(obj->name, "dsl.channel.%d", &args.num) != 1 || args.num < 0)
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	return dsl_handle_request(ctx, req, &args);
+}
+
+static int dsl_channel_stats_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	const struct dsl_snapshot *snap;
+	bool changed;
+
+	snap = dsl_cache_peek_stats(args->num);
+	if (!snap)
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	blob_buf_init(&reply_bb, 0);
+	changed = dsl_add_stats_reply(&reply_bb, args->num, snap, true, args);
+	blobmsg_add_u32(&reply_bb, DSL_SNAPSHOT_AGE, dsl_snapshot_age(&snap->stats_ts));
+	dsl_add_reply_trailer(&reply_bb, args->since, changed);
 
 	// Send the reply
-	ubus_send_reply(ctx, req, bb.head);
+	dsl_send_reply(ctx, req);
 
-__ret:
-	blob_buf_free(&bb);
-	return retval;
+	return UBUS_STATUS_OK;
 }
 
 static int dsl_channel_stats(struct ubus_context *ctx, struct ubus_object *obj,
 		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
 {
-	static struct blob_buf bb;
-	struct blob_attr *tb[__DSL_STATS_MAX];
-	enum dsl_stats_type type = DSL_STATS_QUARTERHOUR + 1;
-	struct dsl_line_channel_stats stats;
-	struct dsl_channel_stats_interval channel_stats_interval;
-	int retval = UBUS_STATUS_OK;
-	int num = -1;
-	int i, j;
-	void *table;
+	struct dsl_request args = {
+		.num = -1, .stats = true, .reply = dsl_channel_stats_reply,
+		.method = DSL_DEBUG_CHANNEL_STATS
+	};
 
-	// Parse and validation check the interval type if any
-	blobmsg_parse(dsl_stats_policy, __DSL_STATS_MAX, tb, blob_data(msg), blob_len(msg));
-	if (tb[DSL_STATS_INTERVAL]) {
-		const char *st = blobmsg_data(tb[DSL_STATS_INTERVAL]);
+	if (dsl_parse_stats_args(msg, &args.type, &args.since, &args.fields, &args.binary) != 0)
+		return UBUS_STATUS_INVALID_ARGUMENT;
 
-		for (i = 0; i < ARRAY_SIZE(dsl_stats_types); i++) {
-			if (strcasecmp(st, dsl_stats_types[i].text) == 0) {
-				type = dsl_stats_types[i].value;
-				break;
-			}
-		}
+	// Get channel statistics, either of one interval or all of them
+	if (sscanf(obj->name, "dsl.channel.%d", &args.num) != 1 || args.num < 0)
+		return UBUS_STATUS_UNKNOWN_ERROR;
 
-		if (i >= ARRAY_SIZE(dsl_stats_types)) {
-			DSLMNGR_LOG(LOG_ERR, "Wrong argument for interval statistics type\n");
-			return UBUS_STATUS_INVALID_ARGUMENT;
-		}
-	}
+	return dsl_handle_request(ctx, req, &args);
+}
 
-	// Initialize the buffer
-	memset(&bb, 0, sizeof(bb));
-	blob_buf_init(&bb, 0);
-
-	// Get channel number
-	sscanf(obj->name, "dsl.channel.%d", &num);
-
-	// Get channel interval statistics
-	if (type >= DSL_STATS_TOTAL && type <= DSL_STATS_QUARTERHOUR) {
-		if (xdsl_ops.get_channel_stats_interval == NULL || (*xdsl_ops.get_channel_stats_interval)
-			(num, type, &channel_stats_interval) != 0) {
-			retval = UBUS_STATUS_UNKNOWN_ERROR;
-			goto __ret;
-		}
-		dsl_stats_channel_interval_to_blob(&channel_stats_interval, &bb);
-	} else {
-		// Get channel statistics
-		if (xdsl_ops.get_channel_stats == NULL || (*xdsl_ops.get_channel_stats)(num, &stats) != 0) {
-			retval = UBUS_STATUS_UNKNOWN_ERROR;
-			goto __ret;
-		}
-		dsl_stats_to_blob(&stats, &bb);
+static int dsl_channel_rates_reply(struct ubus_context *ctx, struct ubus_request_data *req,
+		const struct dsl_request *args)
+{
+	return dsl_rates_reply(ctx, req, args, true);
+}
 
-		// Get all interval statistics
-		for (j = 0; j < ARRAY_SIZE(dsl_stats_types); j++) {
-			table = blobmsg_open_table(&bb, dsl_stats_types[j].text);
+static int dsl_channel_rates(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+	struct dsl_request args = {
+		.num = -1, .stats = true, .reply = dsl_channel_rates_reply,
+		.method = DSL_DEBUG_CHANNEL_RATES
+	};
 
-			if (xdsl_ops.get_channel_stats_interval == NULL || (*xdsl_ops.get_channel_stats_interval)
-				(num, dsl_stats_types[j].value, &channel_stats_interval) != 0) {
-				retval = UBUS_STATUS_UNKNOWN_ERROR;
-				goto __ret;
-			}
-			dsl_stats_channel_interval_to_blob(&channel_stats_interval, &bb);
+	if (sscanf(obj->name, "dsl.channel.%d", &args.num) != 1 || args.num < 0)
+		return UBUS_STATUS_UNKNOWN_ERROR;
 
-			blobmsg_close_table(&bb, table);
-		}
-	}
+	return dsl_handle_request(ctx, req, &args);
+}
 
-	// Send the reply
-	ubus_send_reply(ctx, req, bb.head);
+static int dsl_channel_history(struct ubus_context *ctx, struct ubus_object *obj,
+		struct ubus_request_data *req, const char *method, struct blob_attr *msg)
+{
+	int num = -1;
 
-__ret:
-	blob_buf_free(&bb);
-	return retval;
+	if (sscanf(obj->name, "dsl.channel.%d", &num) != 1 || num < 0)
+		return UBUS_STATUS_UNKNOWN_ERROR;
+
+	return dsl_history(ctx, req, msg, num, true);
 }
 
 static struct ubus_method dsl_channel_methods[] = {
-	{ .name = "status", .handler = dsl_channel_status },
-	UBUS_METHOD("stats", dsl_channel_stats, dsl_stats_policy )
+	UBUS_METHOD("status", dsl_channel_status, dsl_status_policy),
+	UBUS_METHOD("stats", dsl_channel_stats, dsl_stats_policy ),
+	UBUS_METHOD("history", dsl_channel_history, dsl_history_policy),
+	UBUS_METHOD_NOARG("rates", dsl_channel_rates),
+	UBUS_METHOD("telemetry", dsl_telemetry, dsl_telemetry_policy)
 };
 
 static struct ubus_object_type dsl_channel_type = UBUS_OBJECT_TYPE("dsl.channel", dsl_channel_methods);
 
+/**
+ * This function publishes the objects dsl and dsl.debug, which do not depend on the lines and
+ * can therefore be published before the backend is probed.
+ */
 int dsl_add_ubus_objects(struct ubus_context *ctx)
 {
-	struct ubus_object *line_objects = NULL;
-	struct ubus_object *channel_objects = NULL;
-	int ret, max_line, max_channel, i;
+	int ret;
+
+	dsl_ctx = ctx;
 
 	ret = ubus_add_object(ctx, &dsl_main_object);
 	if (ret) {
@@ -904,9 +2662,35 @@ int dsl_add_ubus_objects(struct ubus_context *ctx)
 		return -1;
 	}
 
+	ret = ubus_add_object(ctx, &dsl_debug_object);
+	if (ret) {
+		DSLMNGR_LOG(LOG_ERR, "Failed to add UBUS object '%s', %s\n",
+				dsl_debug_object.name, ubus_strerror(ret));
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * This function publishes the objects dsl.line.x and dsl.channel.x once the backend has been
+ * probed.
+ */
+int dsl_add_line_objects(struct ubus_context *ctx)
+{
+	struct dsl_object *line_objects = NULL;
+	struct dsl_object *channel_objects = NULL;
+	int ret, max_line, max_channel, i;
+
+	replies = calloc(dsl_get_line_number(), sizeof(*replies));
+	if (!replies) {
+		DSLMNGR_LOG(LOG_ERR, "Out of memory\n");
+		return -1;
+	}
+
 	// Add objects dsl.line.x
 	max_line = dsl_get_line_number();
-	line_objects = calloc(max_line, sizeof(struct ubus_object));
+	line_objects = calloc(max_line, sizeof(struct dsl_object));
 	if (!line_objects) {
 		DSLMNGR_LOG(LOG_ERR, "Out of memory\n");
 		return -1;
@@ -919,12 +2703,18 @@ int dsl_add_ubus_objects(struct ubus_context *ctx)
 			return -1;
 		}
 
-		line_objects[i].name = obj_name;
-		line_objects[i].type = &dsl_line_type;
-		line_objects[i].methods = dsl_line_methods;
-		line_objects[i].n_methods = ARRAY_SIZE(dsl_line_methods);
-
-		ret = ubus_add_object(ctx, &line_objects[i]);
+		line_objects[i].obj.name = obj_name;
+		line_objects[i].obj.type = &dsl_line_type;
+		line_objects[i].obj.methods = dsl_line_methods;
+		line_objects[i].obj.n_methods = ARRAY_SIZE(dsl_line_methods);
+		line_objects[i].obj.subscribe_cb = dsl_telemetry_subscribe_cb;
+		line_objects[i].num = i;
+		line_objects[i].channel = false;
+		line_objects[i].period = DSL_TELEMETRY_PERIOD;
+		line_objects[i].timer.cb = dsl_telemetry_timer_cb;
+		line_objects[i].waiter.cb = dsl_telemetry_waiter_cb;
+
+		ret = ubus_add_object(ctx, &line_objects[i].obj);
 		if (ret) {
 			DSLMNGR_LOG(LOG_ERR, "Failed to add UBUS object '%s', %s\n",
 					obj_name, ubus_strerror(ret));
@@ -934,7 +2724,7 @@ int dsl_add_ubus_objects(struct ubus_context *ctx)
 
 	// Add objects dsl.channel.x
 	max_channel = dsl_get_channel_number();
-	channel_objects = calloc(max_channel, sizeof(struct ubus_object));
+	channel_objects = calloc(max_channel, sizeof(struct dsl_object));
 	if (!channel_objects) {
 		DSLMNGR_LOG(LOG_ERR, "Out of memory\n");
 		return -1;
@@ -947,12 +2737,18 @@ int dsl_add_ubus_objects(struct ubus_context *ctx)
 			return -1;
 		}
 
-		channel_objects[i].name = obj_name;
-		channel_objects[i].type = &dsl_channel_type;
-		channel_objects[i].methods = dsl_channel_methods;
-		channel_objects[i].n_methods = ARRAY_SIZE(dsl_channel_methods);
-
-		ret = ubus_add_object(ctx, &channel_objects[i]);
+		channel_objects[i].obj.name = obj_name;
+		channel_objects[i].obj.type = &dsl_channel_type;
+		channel_objects[i].obj.methods = dsl_channel_methods;
+		channel_objects[i].obj.n_methods = ARRAY_SIZE(dsl_channel_methods);
+		channel_objects[i].obj.subscribe_cb = dsl_telemetry_subscribe_cb;
+		channel_objects[i].num = i;
+		channel_objects[i].channel = true;
+		channel_objects[i].period = DSL_TELEMETRY_PERIOD;
+		channel_objects[i].timer.cb = dsl_telemetry_timer_cb;
+		channel_objects[i].waiter.cb = dsl_telemetry_waiter_cb;
+
+		ret = ubus_add_object(ctx, &channel_objects[i].obj);
 		if (ret) {
 			DSLMNGR_LOG(LOG_ERR, "Failed to add UBUS object '%s', %s\n",
 					obj_name, ubus_strerror(ret));
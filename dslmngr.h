@@ -28,14 +28,352 @@ extern "C" {
 #endif
 
 #include <stdio.h>
+#include <stdbool.h>
 #include <syslog.h>
+#include <time.h>
+#include <libubox/list.h>
 #include <libubus.h>
 
+#include "xdsl.h"
+
 #define DSLMNGR_LOG(log_level, format...) fprintf(stderr, ##format)
 
 #define CHECK_POINT() printf("Check point at %s@%s:%d\n", __func__, __FILE__, __LINE__)
 
+/** struct dslmngr_config - Run-time options of dslmngr */
+struct dslmngr_config {
+	/** Time in milliseconds for which the cached line and channel data are served without
+	 *  calling the backend again. 0 disables the cache */
+	unsigned int cache_ttl;
+
+	/** Time in milliseconds for which the cached line and channel data are served while driver
+	 *  notifications are received, since these data are refreshed on each notification. 0 to
+	 *  use cache_ttl */
+	unsigned int status_ttl;
+
+	/** Number of worker threads calling the backend outside of the main thread, -1 for one per
+	 *  line. 0 makes all calls from the main thread */
+	int workers;
+
+	/** Period in seconds at which the main line and channel metrics are recorded in the
+	 *  history. 0 disables the history */
+	unsigned int history_period;
+
+	/** File in which the history is kept across restarts of the daemon. NULL or empty to keep
+	 *  it in memory only */
+	const char *history_file;
+
+	/** Address on which the metrics are served in the OpenMetrics text format, either the path
+	 *  of a unix socket or [host:]port of a TCP socket, the host being the loopback address by
+	 *  default. NULL or empty to not serve them */
+	const char *metrics_addr;
+};
+
+/* Upper bound in seconds of the periods of the timers, one day, so that they fit in an int in ms */
+#define DSL_PERIOD_MAX 86400
+
+extern struct dslmngr_config dslmngr_conf;
+
+/**
+ * struct dslmngr_startup - Progress of the start of dslmngr
+ *
+ * The objects dsl and dsl.debug are published before the backend is probed, which is done by a
+ * thread of its own. The times are in microseconds since dslmngr was started, 0 until reached.
+ */
+struct dslmngr_startup {
+	/** Monotonic time in microseconds at which dslmngr was started */
+	uint64_t start;
+	/** Whether the backend has been probed and all objects published */
+	bool ready;
+	/** When the objects dsl and dsl.debug were published */
+	uint64_t ubus_ready;
+	/** When the probing of the backend finished */
+	uint64_t probed;
+	/** When the line and channel objects were published, i.e. when dslmngr got ready */
+	uint64_t lines_ready;
+};
+
+extern struct dslmngr_startup dslmngr_startup;
+
+/* The 64-bit counters are kept for the intervals DSL_STATS_TOTAL and DSL_STATS_SHOWTIME */
+#define DSL_STATS_WIDE_NUM (DSL_STATS_SHOWTIME - DSL_STATS_TOTAL + 1)
+
+/** struct dsl_line_stats_wide - 64-bit counterpart of struct dsl_line_stats_interval */
+struct dsl_line_stats_wide {
+	uint64_t errored_secs;
+	uint64_t severely_errored_secs;
+};
+
+/** struct dsl_channel_stats_wide - 64-bit counterpart of struct dsl_channel_stats_interval */
+struct dsl_channel_stats_wide {
+	uint64_t xtur_fec_errors;
+	uint64_t xtuc_fec_errors;
+	uint64_t xtur_hec_errors;
+	uint64_t xtuc_hec_errors;
+	uint64_t xtur_crc_errors;
+	uint64_t xtuc_crc_errors;
+};
+
+/**
+ * struct dsl_stats_wide - 64-bit counters accumulated from the successive reads of the 32-bit ones
+ *
+ * They never decrease, a wrap or a reset of a backend counter only adds to them what has been
+ * counted since the previous read. The intervals are indexed by "enum dsl_stats_type" -
+ * DSL_STATS_TOTAL.
+ */
+struct dsl_stats_wide {
+	struct dsl_line_stats_wide line_intervals[DSL_STATS_WIDE_NUM];
+	struct dsl_channel_stats_wide channel_intervals[DSL_STATS_WIDE_NUM];
+};
+
+/* Counters whose rates are computed, the errored seconds of a line and the errors of its channel */
+enum dsl_rate_counter_type {
+	DSL_RATE_ERRORED_SECS,
+	DSL_RATE_SEVERELY_ERRORED_SECS,
+	DSL_RATE_XTUR_FEC_ERRORS,
+	DSL_RATE_XTUC_FEC_ERRORS,
+	DSL_RATE_XTUR_HEC_ERRORS,
+	DSL_RATE_XTUC_HEC_ERRORS,
+	DSL_RATE_XTUR_CRC_ERRORS,
+	DSL_RATE_XTUC_CRC_ERRORS,
+	__DSL_RATE_MAX,
+};
+
+/** struct dsl_rate - Rate of a counter per second, between the last two reads and on average */
+struct dsl_rate {
+	double instant;
+	double avg_1min;
+	double avg_15min;
+};
+
+/** struct dsl_stats_rates - Rates of the counters of a line, valid once read twice */
+struct dsl_stats_rates {
+	bool valid;
+	struct dsl_rate rates[__DSL_RATE_MAX];
+};
+
+/* Version of the layout of the binary replies, incremented whenever it changes */
+#define DSL_BINARY_VERSION 1
+
+/* Written in the byte order of dslmngr, which a client reads as 0x0201 if its order differs */
+#define DSL_BINARY_BYTE_ORDER 0x0102
+
+/** enum dsl_binary_type - Content of a binary reply */
+enum dsl_binary_type {
+	DSL_BINARY_LINE = 1,		// struct dsl_line
+	DSL_BINARY_CHANNEL,		// struct dsl_channel
+	DSL_BINARY_LINE_STATS,		// struct dsl_binary_line_stats
+	DSL_BINARY_CHANNEL_STATS,	// struct dsl_binary_channel_stats
+};
+
+/**
+ * struct dsl_binary_header - Header of the "data" field of a binary reply
+ *
+ * It is followed, header_size bytes from its start, by an image of size bytes of the structure
+ * given by type. The header and the image are in the byte order given by byte_order and the image
+ * has the layout of the structure in dslmngr, so that a client built for the same platform with
+ * the same DSL_BINARY_VERSION can copy it into the structure after checking the size.
+ */
+struct dsl_binary_header {
+	uint16_t version;
+	uint16_t byte_order;
+	uint16_t type;
+	uint16_t header_size;
+	uint32_t size;
+	/** Generation of the data, as returned in the "generation" field */
+	uint32_t gen;
+};
+
+/** struct dsl_binary_line_stats - Statistics of a line, 64-bit counters all zero until valid */
+struct dsl_binary_line_stats {
+	struct dsl_line_channel_stats stats;
+	struct dsl_line_stats_interval intervals[DSL_STATS_INTERVAL_NUM];
+	struct dsl_line_stats_wide wide[DSL_STATS_WIDE_NUM];
+};
+
+/** struct dsl_binary_channel_stats - Statistics of a channel, 64-bit counters all zero until valid */
+struct dsl_binary_channel_stats {
+	struct dsl_line_channel_stats stats;
+	struct dsl_channel_stats_interval intervals[DSL_STATS_INTERVAL_NUM];
+	struct dsl_channel_stats_wide wide[DSL_STATS_WIDE_NUM];
+};
+
+/**
+ * struct dsl_snapshot - Cached data of a DSL line and its channel
+ *
+ * The generation numbers are taken from a counter shared by all snapshots, which is incremented
+ * each time a refresh brings data different from the cached ones, or fails where the previous one
+ * had succeeded. They only change when the data change and never decrease.
+ *
+ * A stale snapshot, e.g. after the driver has reported a change, is refreshed on next use whatever
+ * its age.
+ */
+struct dsl_snapshot {
+	/** Whether line and channel are valid, when they were retrieved and when they last changed */
+	bool status_valid;
+	bool status_stale;
+	struct timespec status_ts;
+	uint32_t status_gen;
+	struct dsl_line line;
+	struct dsl_channel channel;
+
+	/** Whether the statistics counters are valid, when they were retrieved and when they last changed */
+	bool stats_valid;
+	bool stats_stale;
+	struct timespec stats_ts;
+	uint32_t stats_gen;
+	struct dsl_stats_all stats;
+
+	/** Whether the 64-bit counters have been initialized from a first read of the statistics */
+	bool wide_valid;
+	struct dsl_stats_wide wide;
+
+	/** Rates of the 64-bit counters, updated at each read of the statistics */
+	struct dsl_stats_rates rates;
+};
+
+/**
+ * struct dsl_job - A unit of backend work run by a worker thread
+ *
+ * run() is called in a worker thread and must only access data owned by the job. done() is called
+ * in the main thread once an asynchronous job has been run.
+ */
+struct dsl_job {
+	struct list_head list;
+	void (*run)(struct dsl_job *job);
+	void (*done)(struct dsl_job *job);
+	int *pending;
+};
+
+int dsl_worker_init(int thread_num);
+void dsl_worker_run(struct dsl_job **jobs, int num);
+int dsl_worker_submit(struct dsl_job *job);
+int dsl_worker_spawn(struct dsl_job *job);
+
+/**
+ * struct dsl_cache_waiter - A request waiting for the asynchronous refresh of some lines
+ *
+ * The bitmaps hold the lines whose status or statistics are still being refreshed, hence
+ * XDSL_MAX_LINES must not exceed 32.
+ */
+struct dsl_cache_waiter {
+	struct list_head list;
+	uint32_t status_lines;
+	uint32_t stats_lines;
+	void (*cb)(struct dsl_cache_waiter *waiter);
+};
+
 int dsl_add_ubus_objects(struct ubus_context *ctx);
+int dsl_add_line_objects(struct ubus_context *ctx);
+
+int dslmngr_nl_init(struct ubus_context *ctx);
+
+int dsl_history_init(void);
+int dsl_history_to_blob(int line_num, const char *name, bool channel, uint32_t start, uint32_t end,
+		struct blob_buf *bb);
+
+void dsl_rates_update(struct dsl_stats_rates *rates, const struct dsl_stats_wide *prev,
+		const struct dsl_stats_wide *curr, unsigned int elapsed);
+int dsl_rates_to_blob(const struct dsl_stats_rates *rates, bool channel, struct blob_buf *bb);
+
+/**
+ * struct dsl_tones_request - Selection of per-tone data
+ *
+ * types is a bitmap of "enum dsl_tones_type". The values of the groups including the tones start
+ * to end are returned, in hex instead of binary if hex is true.
+ */
+struct dsl_tones_request {
+	uint32_t types;
+	bool us;
+	bool ds;
+	unsigned int start;
+	unsigned int end;
+	bool hex;
+};
+
+/**
+ * struct dsl_tones_waiter - A request waiting for the asynchronous read of per-tone data
+ *
+ * entries is the bitmap of the data of the line still being read, bit type * 2 + upstream.
+ */
+struct dsl_tones_waiter {
+	struct list_head list;
+	int line_num;
+	uint32_t entries;
+	void (*cb)(struct dsl_tones_waiter *waiter);
+};
+
+int dsl_tones_type(const char *name);
+void dsl_tones_refresh(int line_num, const struct dsl_snapshot *snap, const struct dsl_tones_request *req);
+int dsl_tones_refresh_async(struct dsl_tones_waiter *waiter, int line_num, const struct dsl_snapshot *snap,
+		const struct dsl_tones_request *req);
+int dsl_tones_to_blob(int line_num, const struct dsl_tones_request *req, struct blob_buf *bb);
+
+/** enum dsl_debug_method - UBUS methods whose latency is recorded */
+enum dsl_debug_method {
+	DSL_DEBUG_STATUS,
+	DSL_DEBUG_STATS,
+	DSL_DEBUG_LINE_STATUS,
+	DSL_DEBUG_LINE_STATS,
+	DSL_DEBUG_LINE_HISTORY,
+	DSL_DEBUG_LINE_RATES,
+	DSL_DEBUG_LINE_TELEMETRY,
+	DSL_DEBUG_LINE_TONES,
+	DSL_DEBUG_CHANNEL_STATUS,
+	DSL_DEBUG_CHANNEL_STATS,
+	DSL_DEBUG_CHANNEL_HISTORY,
+	DSL_DEBUG_CHANNEL_RATES,
+	DSL_DEBUG_CHANNEL_TELEMETRY,
+	__DSL_DEBUG_METHOD_MAX,
+};
+
+/**
+ * enum dsl_debug_phase - Phases of a UBUS call
+ *
+ * @DSL_DEBUG_BACKEND: waiting for the backend, only for the calls whose data were not cached
+ * @DSL_DEBUG_SERIALIZE: building the reply
+ * @DSL_DEBUG_SEND: handing the reply over to ubusd
+ */
+enum dsl_debug_phase {
+	DSL_DEBUG_BACKEND,
+	DSL_DEBUG_SERIALIZE,
+	DSL_DEBUG_SEND,
+	__DSL_DEBUG_PHASE_MAX,
+};
+
+uint64_t dsl_debug_now(void);
+uint64_t dsl_debug_record(enum dsl_debug_method method, enum dsl_debug_phase phase, uint64_t start);
+int dsl_debug_method(const char *name);
+void dsl_debug_to_blob(int method, struct blob_buf *bb);
+void dsl_debug_reset(int method);
+
+/**
+ * struct dsl_metrics_buf - Buffer in which the metrics are rendered, growing as needed
+ *
+ * error is set if the buffer could not grow, the text is then incomplete.
+ */
+struct dsl_metrics_buf {
+	char *data;
+	size_t len;
+	size_t size;
+	bool error;
+};
+
+void dsl_metrics_printf(struct dsl_metrics_buf *buf, const char *fmt, ...)
+		__attribute__((format(printf, 2, 3)));
+void dsl_metrics_add_label(struct dsl_metrics_buf *buf, const char *name, const char *value);
+int dsl_metrics_render(struct dsl_metrics_buf *buf);
+int dsl_metrics_init(const char *addr);
+
+int dsl_cache_init(void);
+const struct dsl_snapshot *dsl_cache_peek_status(int line_num);
+const struct dsl_snapshot *dsl_cache_peek_stats(int line_num);
+bool dsl_cache_fresh(int line_num, bool status, bool stats);
+void dsl_cache_update(int line_num);
+void dsl_cache_refresh(int line_num, bool status, bool stats);
+int dsl_cache_refresh_async(struct dsl_cache_waiter *waiter, int line_num, bool status, bool stats);
+unsigned int dsl_snapshot_age(const struct timespec *ts);
+uint32_t dsl_cache_generation(void);
 
 #ifdef __cplusplus
 }
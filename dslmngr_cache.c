@@ -0,0 +1,587 @@
+/*
+ * dslmngr_cache.c - snapshot cache of the DSL line and channel data
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: anjan.chanda@iopsys.eu
+ *         yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "xdsl.h"
+#include "dslmngr.h"
+
+/* One snapshot per line. The channel of a line shares the line's index */
+static struct dsl_snapshot *snapshots;
+static int snapshot_num;
+
+/* Incremented whenever the data of any snapshot changes */
+static uint32_t generation;
+
+/**
+ * struct dsl_cache_job - Refresh of one line run by a worker thread
+ *
+ * The data are fetched into the job and only committed to the snapshot by the main thread.
+ */
+struct dsl_cache_job {
+	struct dsl_job job;
+	int line_num;
+	bool status;
+	bool stats;
+	/** Whether an asynchronous refresh is in progress */
+	bool busy;
+	/** Number of invalidations of the line when the asynchronous refresh was started */
+	unsigned int invalidation;
+	/** Order in which the fetch was started, see fetch_seq */
+	uint64_t seq;
+	int status_ret;
+	int stats_ret;
+	struct dsl_line line;
+	struct dsl_channel channel;
+	struct dsl_stats_all stats_all;
+};
+
+/* Jobs of the synchronous refreshes */
+static struct dsl_cache_job *cache_jobs;
+static struct dsl_job **cache_job_list;
+
+/* Jobs of the asynchronous refreshes, one per line for the status and one for the statistics.
+ * Requests arriving while a line is being refreshed wait for the same job */
+static struct dsl_cache_job *status_jobs;
+static struct dsl_cache_job *stats_jobs;
+
+/* Number of times each line has been invalidated */
+static unsigned int *invalidations;
+
+/* Incremented whenever a fetch is started. A synchronous refresh may run while an asynchronous one
+ * of the same line is still in progress, so the fetches can finish out of order. Per line, the
+ * order of the fetches whose status and statistics have been committed, older data are dropped */
+static uint64_t fetch_seq;
+static uint64_t *status_seqs;
+static uint64_t *stats_seqs;
+
+/* Upper bound of the waiters so that a burst of requests cannot exhaust the memory */
+#define DSL_CACHE_WAITER_MAX 64
+
+static LIST_HEAD(waiters);
+static int waiter_num;
+
+static void dsl_cache_now(struct timespec *ts)
+{
+	clock_gettime(CLOCK_MONOTONIC, ts);
+}
+
+unsigned int dsl_snapshot_age(const struct timespec *ts)
+{
+	struct timespec now;
+	long long ms;
+
+	dsl_cache_now(&now);
+	ms = (long long)(now.tv_sec - ts->tv_sec) * 1000 + (now.tv_nsec - ts->tv_nsec) / 1000000;
+
+	return ms < 0 ? 0 : (unsigned int)ms;
+}
+
+static bool dsl_snapshot_fresh(bool valid, const struct timespec *ts, unsigned int ttl)
+{
+	return valid && dsl_snapshot_age(ts) < ttl;
+}
+
+/* Line and channel data only change along with a driver notification if they are received */
+static bool dsl_status_fresh(const struct dsl_snapshot *snap)
+{
+	return !snap->status_stale && dsl_snapshot_fresh(snap->status_valid, &snap->status_ts,
+			dslmngr_conf.status_ttl ? dslmngr_conf.status_ttl : dslmngr_conf.cache_ttl);
+}
+
+static bool dsl_stats_fresh(const struct dsl_snapshot *snap)
+{
+	return !snap->stats_stale && dsl_snapshot_fresh(snap->stats_valid, &snap->stats_ts,
+			dslmngr_conf.cache_ttl);
+}
+
+uint32_t dsl_cache_generation(void)
+{
+	return generation;
+}
+
+int dsl_cache_init(void)
+{
+	int max_line = dsl_get_line_number();
+
+	if (max_line <= 0) {
+		DSLMNGR_LOG(LOG_ERR, "Invalid number of DSL lines, %d\n", max_line);
+		return -1;
+	}
+
+	snapshots = calloc(max_line, sizeof(*snapshots));
+	cache_jobs = calloc(max_line, sizeof(*cache_jobs));
+	cache_job_list = calloc(max_line, sizeof(*cache_job_list));
+	status_jobs = calloc(max_line, sizeof(*status_jobs));
+	stats_jobs = calloc(max_line, sizeof(*stats_jobs));
+	invalidations = calloc(max_line, sizeof(*invalidations));
+	status_seqs = calloc(max_line, sizeof(*status_seqs));
+	stats_seqs = calloc(max_line, sizeof(*stats_seqs));
+	if (!snapshots || !cache_jobs || !cache_job_list || !status_jobs || !stats_jobs || !invalidations ||
+		!status_seqs || !stats_seqs) {
+		DSLMNGR_LOG(LOG_ERR, "Out of memory\n");
+		return -1;
+	}
+	snapshot_num = max_line;
+
+	return 0;
+}
+
+/* Thread safe, it only calls the backend */
+static int dsl_cache_fetch_status(int line_num, struct dsl_line *line, struct dsl_channel *channel)
+{
+	if (xdsl_ops.get_line_info == NULL || (*xdsl_ops.get_line_info)(line_num, line) != 0 ||
+		xdsl_ops.get_channel_info == NULL || (*xdsl_ops.get_channel_info)(line_num, channel) != 0)
+		return -1;
+
+	return 0;
+}
+
+static void dsl_cache_commit_status(struct dsl_snapshot *snap, int ret,
+		const struct dsl_line *line, const struct dsl_channel *channel)
+{
+	if (ret != 0) {
+		// Data which are no longer available have changed as well
+		if (snap->status_valid)
+			generation++;
+		snap->status_valid = false;
+		return;
+	}
+
+	if (!snap->status_valid || memcmp(&snap->line, line, sizeof(*line)) != 0 ||
+		memcmp(&snap->channel, channel, sizeof(*channel)) != 0) {
+		snap->line = *line;
+		snap->channel = *channel;
+		snap->status_gen = ++generation;
+	}
+	dsl_cache_now(&snap->status_ts);
+	snap->status_valid = true;
+	snap->status_stale = false;
+}
+
+/**
+ * This function returns the snapshot of a line if its line and channel data are valid, without
+ * refreshing them.
+ */
+const struct dsl_snapshot *dsl_cache_peek_status(int line_num)
+{
+	if (line_num < 0 || line_num >= snapshot_num || !snapshots[line_num].status_valid)
+		return NULL;
+
+	return &snapshots[line_num];
+}
+
+/* Fallback for backends not providing get_stats_all() */
+static int dsl_cache_fetch_stats(int line_num, struct dsl_stats_all *stats)
+{
+	int i;
+
+	if (xdsl_ops.get_line_stats == NULL || (*xdsl_ops.get_line_stats)(line_num, &stats->line) != 0 ||
+		xdsl_ops.get_channel_stats == NULL || (*xdsl_ops.get_channel_stats)(line_num, &stats->channel) != 0)
+		return -1;
+
+	for (i = 0; i < DSL_STATS_INTERVAL_NUM; i++) {
+		if (xdsl_ops.get_line_stats_interval == NULL || (*xdsl_ops.get_line_stats_interval)
+			(line_num, DSL_STATS_TOTAL + i, &stats->line_intervals[i]) != 0)
+			return -1;
+
+		if (xdsl_ops.get_channel_stats_interval == NULL || (*xdsl_ops.get_channel_stats_interval)
+			(line_num, DSL_STATS_TOTAL + i, &stats->channel_intervals[i]) != 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+/* Thread safe, it only calls the backend */
+static int dsl_cache_fetch_stats_all(int line_num, struct dsl_stats_all *stats)
+{
+	// Prefer one backend transaction for all counters so that they are taken at the same instant
+	if (xdsl_ops.get_stats_all != NULL)
+		return (*xdsl_ops.get_stats_all)(line_num, stats);
+
+	return dsl_cache_fetch_stats(line_num, stats);
+}
+
+/* Tolerance in seconds on the start of an interval, which is rounded by the backend */
+#define DSL_STATS_START_SLACK 2
+
+/**
+ * This function adds to a 64-bit counter what a 32-bit counter has counted since its previous
+ * value. A counter lower than before has wrapped, unless the interval has been restarted.
+ */
+static void dsl_counter_accumulate(uint64_t *wide, unsigned int prev, unsigned int curr, bool restarted)
+{
+	if (curr == DSL_INVALID_STATS_COUNTER)
+		return;
+
+	if (prev == DSL_INVALID_STATS_COUNTER || restarted)
+		*wide += curr;
+	else if (curr >= prev)
+		*wide += curr - prev;
+	else
+		*wide += (uint64_t)UINT32_MAX + 1 - prev + curr;
+}
+
+/**
+ * This function returns whether an interval has been restarted between two reads. Its start, the
+ * number of seconds since the interval began, must have grown by the time elapsed in between. A
+ * start of 0 tells that the interval is not running, e.g. showtime while the line is down, and its
+ * counters keep their last values until it begins again.
+ */
+static bool dsl_interval_restarted(unsigned int prev_start, unsigned int curr_start, unsigned int elapsed)
+{
+	if (curr_start == 0)
+		return false;
+
+	if (prev_start == 0)
+		return true;
+
+	return (uint64_t)curr_start + DSL_STATS_START_SLACK < (uint64_t)prev_start + elapsed;
+}
+
+static void dsl_cache_accumulate(struct dsl_snapshot *snap, const struct dsl_stats_all *stats,
+		unsigned int elapsed)
+{
+	const struct dsl_stats_all *prev = &snap->stats;
+	struct dsl_stats_wide *wide = &snap->wide;
+	bool line_restarted[DSL_STATS_WIDE_NUM], channel_restarted[DSL_STATS_WIDE_NUM];
+	int i;
+
+	// The first read gives the initial values
+	if (!snap->wide_valid) {
+		memset(wide, 0, sizeof(*wide));
+		memset(line_restarted, 1, sizeof(line_restarted));
+		memset(channel_restarted, 1, sizeof(channel_restarted));
+		snap->wide_valid = true;
+	} else {
+		line_restarted[0] = dsl_interval_restarted(prev->line.total_start, stats->line.total_start, elapsed);
+		line_restarted[1] = dsl_interval_restarted(prev->line.showtime_start, stats->line.showtime_start, elapsed);
+		channel_restarted[0] = dsl_interval_restarted(prev->channel.total_start,
+				stats->channel.total_start, elapsed);
+		channel_restarted[1] = dsl_interval_restarted(prev->channel.showtime_start,
+				stats->channel.showtime_start, elapsed);
+	}
+
+	for (i = 0; i < DSL_STATS_WIDE_NUM; i++) {
+		dsl_counter_accumulate(&wide->line_intervals[i].errored_secs,
+				prev->line_intervals[i].errored_secs,
+				stats->line_intervals[i].errored_secs, line_restarted[i]);
+		dsl_counter_accumulate(&wide->line_intervals[i].severely_errored_secs,
+				prev->line_intervals[i].severely_errored_secs,
+				stats->line_intervals[i].severely_errored_secs, line_restarted[i]);
+
+		dsl_counter_accumulate(&wide->channel_intervals[i].xtur_fec_errors,
+				prev->channel_intervals[i].xtur_fec_errors,
+				stats->channel_intervals[i].xtur_fec_errors, channel_restarted[i]);
+		dsl_counter_accumulate(&wide->channel_intervals[i].xtuc_fec_errors,
+				prev->channel_intervals[i].xtuc_fec_errors,
+				stats->channel_intervals[i].xtuc_fec_errors, channel_restarted[i]);
+		dsl_counter_accumulate(&wide->channel_intervals[i].xtur_hec_errors,
+				prev->channel_intervals[i].xtur_hec_errors,
+				stats->channel_intervals[i].xtur_hec_errors, channel_restarted[i]);
+		dsl_counter_accumulate(&wide->channel_intervals[i].xtuc_hec_errors,
+				prev->channel_intervals[i].xtuc_hec_errors,
+				stats->channel_intervals[i].xtuc_hec_errors, channel_restarted[i]);
+		dsl_counter_accumulate(&wide->channel_intervals[i].xtur_crc_errors,
+				prev->channel_intervals[i].xtur_crc_errors,
+				stats->channel_intervals[i].xtur_crc_errors, channel_restarted[i]);
+		dsl_counter_accumulate(&wide->channel_intervals[i].xtuc_crc_errors,
+				prev->channel_intervals[i].xtuc_crc_errors,
+				stats->channel_intervals[i].xtuc_crc_errors, channel_restarted[i]);
+	}
+}
+
+static void dsl_cache_commit_stats(struct dsl_snapshot *snap, int ret, const struct dsl_stats_all *stats)
+{
+	struct dsl_stats_wide prev_wide;
+	unsigned int elapsed;
+	bool had_wide;
+
+	if (ret != 0) {
+		// Data which are no longer available have changed as well
+		if (snap->stats_valid)
+			generation++;
+		snap->stats_valid = false;
+		return;
+	}
+
+	// The previous counters are those of the last successful read, along with stats_ts
+	elapsed = dsl_snapshot_age(&snap->stats_ts);
+	had_wide = snap->wide_valid;
+	prev_wide = snap->wide;
+	dsl_cache_accumulate(snap, stats, elapsed / 1000);
+	if (had_wide)
+		dsl_rates_update(&snap->rates, &prev_wide, &snap->wide, elapsed);
+
+	if (!snap->stats_valid || memcmp(&snap->stats, stats, sizeof(*stats)) != 0) {
+		snap->stats = *stats;
+		snap->stats_gen = ++generation;
+	}
+	dsl_cache_now(&snap->stats_ts);
+	snap->stats_valid = true;
+	snap->stats_stale = false;
+}
+
+/**
+ * This function returns the snapshot of a line if its statistics counters are valid, without
+ * refreshing them.
+ */
+const struct dsl_snapshot *dsl_cache_peek_stats(int line_num)
+{
+	if (line_num < 0 || line_num >= snapshot_num || !snapshots[line_num].stats_valid)
+		return NULL;
+
+	return &snapshots[line_num];
+}
+
+/**
+ * This function returns whether the data of a line, or of all lines if line_num is -1, can be
+ * served from the cache without calling the backend.
+ */
+bool dsl_cache_fresh(int line_num, bool status, bool stats)
+{
+	struct dsl_snapshot *snap;
+	int i;
+
+	for (i = 0; i < snapshot_num; i++) {
+		if (line_num >= 0 && i != line_num)
+			continue;
+
+		snap = &snapshots[i];
+		if (status && !dsl_status_fresh(snap))
+			return false;
+		if (stats && !dsl_stats_fresh(snap))
+			return false;
+	}
+
+	return line_num < snapshot_num;
+}
+
+/**
+ * This function commits the data fetched by a job to the snapshot of its line. Data fetched before
+ * those already committed are dropped, e.g. those of an asynchronous refresh which has been
+ * overtaken by a synchronous one. Committing them would take the counters back in time, which
+ * would be seen as a wrap by the 64-bit counters.
+ */
+static void dsl_cache_commit(struct dsl_cache_job *cj)
+{
+	struct dsl_snapshot *snap = &snapshots[cj->line_num];
+
+	if (cj->status && cj->seq > status_seqs[cj->line_num]) {
+		dsl_cache_commit_status(snap, cj->status_ret, &cj->line, &cj->channel);
+		status_seqs[cj->line_num] = cj->seq;
+	}
+	if (cj->stats && cj->seq > stats_seqs[cj->line_num]) {
+		dsl_cache_commit_stats(snap, cj->stats_ret, &cj->stats_all);
+		stats_seqs[cj->line_num] = cj->seq;
+	}
+}
+
+static void dsl_cache_job_run(struct dsl_job *job)
+{
+	struct dsl_cache_job *cj = container_of(job, struct dsl_cache_job, job);
+
+	if (cj->status)
+		cj->status_ret = dsl_cache_fetch_status(cj->line_num, &cj->line, &cj->channel);
+	if (cj->stats)
+		cj->stats_ret = dsl_cache_fetch_stats_all(cj->line_num, &cj->stats_all);
+}
+
+/**
+ * This function marks the snapshots of a line, or of all lines if line_num is -1, as stale so that
+ * they are refreshed before being served again. The cached data remain available until then.
+ */
+static void dsl_cache_invalidate(int line_num)
+{
+	int i;
+
+	for (i = 0; i < snapshot_num; i++) {
+		if (line_num >= 0 && i != line_num)
+			continue;
+
+		snapshots[i].status_stale = true;
+		snapshots[i].stats_stale = true;
+		invalidations[i]++;
+	}
+}
+
+/**
+ * This function refreshes the stale snapshots of a line, or of all lines if line_num is -1. The
+ * lines are fetched in parallel by the worker threads so that the time taken is that of the
+ * slowest line, not the sum of all.
+ */
+void dsl_cache_refresh(int line_num, bool status, bool stats)
+{
+	struct dsl_snapshot *snap;
+	struct dsl_cache_job *cj;
+	int i, num = 0;
+
+	for (i = 0; i < snapshot_num; i++) {
+		if (line_num >= 0 && i != line_num)
+			continue;
+
+		snap = &snapshots[i];
+		cj = &cache_jobs[i];
+
+		cj->status = status && !dsl_status_fresh(snap);
+		cj->stats = stats && !dsl_stats_fresh(snap);
+		if (!cj->status && !cj->stats)
+			continue;
+
+		cj->job.run = dsl_cache_job_run;
+		cj->line_num = i;
+		cj->seq = ++fetch_seq;
+		cache_job_list[num++] = &cj->job;
+	}
+
+	dsl_worker_run(cache_job_list, num);
+
+	for (i = 0; i < num; i++)
+		dsl_cache_commit(container_of(cache_job_list[i], struct dsl_cache_job, job));
+}
+
+static bool dsl_cache_submit(struct dsl_cache_job *cj, int line_num, bool stats);
+
+/* Called in the main thread when an asynchronous refresh of a line is finished */
+static void dsl_cache_job_done(struct dsl_job *job)
+{
+	struct dsl_cache_job *cj = container_of(job, struct dsl_cache_job, job);
+	struct dsl_snapshot *snap = &snapshots[cj->line_num];
+	struct dsl_cache_waiter *w, *tmp;
+	uint32_t bit = 1U << cj->line_num;
+
+	dsl_cache_commit(cj);
+	cj->busy = false;
+
+	list_for_each_entry_safe(w, tmp, &waiters, list) {
+		if (cj->status)
+			w->status_lines &= ~bit;
+		if (cj->stats)
+			w->stats_lines &= ~bit;
+		if (w->status_lines || w->stats_lines)
+			continue;
+
+		list_del(&w->list);
+		waiter_num--;
+		w->cb(w);
+	}
+
+	// The line has changed while being fetched, the data may be older than the change
+	if (cj->invalidation != invalidations[cj->line_num]) {
+		if (cj->status)
+			snap->status_stale = true;
+		if (cj->stats)
+			snap->stats_stale = true;
+		dsl_cache_submit(cj, cj->line_num, cj->stats);
+	}
+}
+
+static bool dsl_cache_submit(struct dsl_cache_job *cj, int line_num, bool stats)
+{
+	if (cj->busy)
+		return true;
+
+	cj->job.run = dsl_cache_job_run;
+	cj->job.done = dsl_cache_job_done;
+	cj->line_num = line_num;
+	cj->status = !stats;
+	cj->stats = stats;
+	cj->invalidation = invalidations[line_num];
+	cj->seq = ++fetch_seq;
+	if (dsl_worker_submit(&cj->job) != 0)
+		return false;
+
+	cj->busy = true;
+	return true;
+}
+
+/**
+ * This function refreshes the stale snapshots of a line, or of all lines if line_num is -1, in the
+ * worker threads without blocking the caller. waiter->cb() is called in the main thread once all
+ * of them have been refreshed. A line already being refreshed is not fetched a second time, the
+ * waiter is completed together with the pending refresh instead.
+ *
+ * @return 0 if the waiter will be called, 1 if all snapshots are fresh and -1 if the refresh can
+ *         not be done asynchronously, e.g. because there is no worker thread or too many waiters
+ */
+int dsl_cache_refresh_async(struct dsl_cache_waiter *waiter, int line_num, bool status, bool stats)
+{
+	struct dsl_snapshot *snap;
+	int i;
+
+	if (waiter_num >= DSL_CACHE_WAITER_MAX)
+		return -1;
+
+	waiter->status_lines = 0;
+	waiter->stats_lines = 0;
+	for (i = 0; i < snapshot_num; i++) {
+		if (line_num >= 0 && i != line_num)
+			continue;
+
+		snap = &snapshots[i];
+		if (status && !dsl_status_fresh(snap)) {
+			if (!dsl_cache_submit(&status_jobs[i], i, false))
+				return -1;
+			waiter->status_lines |= 1U << i;
+		}
+		if (stats && !dsl_stats_fresh(snap)) {
+			if (!dsl_cache_submit(&stats_jobs[i], i, true))
+				return -1;
+			waiter->stats_lines |= 1U << i;
+		}
+	}
+
+	if (!waiter->status_lines && !waiter->stats_lines)
+		return 1;
+
+	list_add_tail(&waiter->list, &waiters);
+	waiter_num++;
+
+	return 0;
+}
+
+/**
+ * This function is called when the driver reports a change of a line, or of all lines if line_num
+ * is -1. The cached data are invalidated and refreshed right away in the worker threads, so that
+ * the change is visible to the next request without it having to wait for the backend.
+ */
+void dsl_cache_update(int line_num)
+{
+	int i;
+
+	dsl_cache_invalidate(line_num);
+
+	for (i = 0; i < snapshot_num; i++) {
+		if (line_num >= 0 && i != line_num)
+			continue;
+
+		// Without worker threads the data are refreshed on next use
+		if (!dsl_cache_submit(&status_jobs[i], i, false) ||
+			!dsl_cache_submit(&stats_jobs[i], i, true))
+			break;
+	}
+}
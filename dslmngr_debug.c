@@ -0,0 +1,198 @@
+/*
+ * dslmngr_debug.c - latency of the UBUS methods of dslmngr
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: anjan.chanda@iopsys.eu
+ *         yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <libubox/blobmsg.h>
+#include <libubox/utils.h>
+
+#include "dslmngr.h"
+
+/*
+ * The latencies are in microseconds. Those below DSL_DEBUG_SUB have a bucket each, then each power
+ * of 2 is split into DSL_DEBUG_SUB buckets, hence a bucket is at most 25% wide. The last bucket
+ * ends at UINT32_MAX, i.e. more than an hour.
+ */
+#define DSL_DEBUG_SUB_BITS 2
+#define DSL_DEBUG_SUB (1U << DSL_DEBUG_SUB_BITS)
+#define DSL_DEBUG_BUCKETS ((32 - DSL_DEBUG_SUB_BITS + 1) * DSL_DEBUG_SUB)
+
+/** struct dsl_debug_hist - Histogram of the latencies of a phase of a method */
+struct dsl_debug_hist {
+	uint32_t count;
+	uint32_t max;
+	uint64_t sum;
+	uint32_t buckets[DSL_DEBUG_BUCKETS];
+};
+
+/* Only used by the main thread, which runs all UBUS methods, hence without any lock */
+static struct dsl_debug_hist debug_hists[__DSL_DEBUG_METHOD_MAX][__DSL_DEBUG_PHASE_MAX];
+
+static const char * const dsl_debug_method_names[__DSL_DEBUG_METHOD_MAX] = {
+	[DSL_DEBUG_STATUS] = "dsl.status",
+	[DSL_DEBUG_STATS] = "dsl.stats",
+	[DSL_DEBUG_LINE_STATUS] = "dsl.line.status",
+	[DSL_DEBUG_LINE_STATS] = "dsl.line.stats",
+	[DSL_DEBUG_LINE_HISTORY] = "dsl.line.history",
+	[DSL_DEBUG_LINE_RATES] = "dsl.line.rates",
+	[DSL_DEBUG_LINE_TELEMETRY] = "dsl.line.telemetry",
+	[DSL_DEBUG_LINE_TONES] = "dsl.line.tones",
+	[DSL_DEBUG_CHANNEL_STATUS] = "dsl.channel.status",
+	[DSL_DEBUG_CHANNEL_STATS] = "dsl.channel.stats",
+	[DSL_DEBUG_CHANNEL_HISTORY] = "dsl.channel.history",
+	[DSL_DEBUG_CHANNEL_RATES] = "dsl.channel.rates",
+	[DSL_DEBUG_CHANNEL_TELEMETRY] = "dsl.channel.telemetry",
+};
+
+static const char * const dsl_debug_phase_names[__DSL_DEBUG_PHASE_MAX] = {
+	[DSL_DEBUG_BACKEND] = "backend",
+	[DSL_DEBUG_SERIALIZE] = "serialize",
+	[DSL_DEBUG_SEND] = "send",
+};
+
+/* Monotonic time in microseconds */
+uint64_t dsl_debug_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static unsigned int dsl_debug_bucket(uint32_t value)
+{
+	unsigned int exp;
+
+	if (value < DSL_DEBUG_SUB)
+		return value;
+
+	exp = 31 - __builtin_clz(value);
+	return (exp - DSL_DEBUG_SUB_BITS + 1) * DSL_DEBUG_SUB + ((value >> (exp - DSL_DEBUG_SUB_BITS)) & (DSL_DEBUG_SUB - 1));
+}
+
+/* Lowest value of a bucket, that of bucket DSL_DEBUG_BUCKETS being beyond UINT32_MAX */
+static uint64_t dsl_debug_bucket_min(unsigned int bucket)
+{
+	unsigned int exp;
+
+	if (bucket < DSL_DEBUG_SUB)
+		return bucket;
+
+	exp = bucket / DSL_DEBUG_SUB + DSL_DEBUG_SUB_BITS - 1;
+	return (uint64_t)(DSL_DEBUG_SUB + bucket % DSL_DEBUG_SUB) << (exp - DSL_DEBUG_SUB_BITS);
+}
+
+/**
+ * This function records the latency of a phase of a method, from start to now.
+ *
+ * @return the current time, from which the next phase can be measured
+ */
+uint64_t dsl_debug_record(enum dsl_debug_method method, enum dsl_debug_phase phase, uint64_t start)
+{
+	struct dsl_debug_hist *hist = &debug_hists[method][phase];
+	uint64_t now = dsl_debug_now();
+	uint32_t value = now - start > UINT32_MAX ? UINT32_MAX : (uint32_t)(now - start);
+
+	hist->count++;
+	hist->sum += value;
+	if (value > hist->max)
+		hist->max = value;
+	hist->buckets[dsl_debug_bucket(value)]++;
+
+	return now;
+}
+
+int dsl_debug_method(const char *name)
+{
+	int i;
+
+	for (i = 0; i < __DSL_DEBUG_METHOD_MAX; i++) {
+		if (strcmp(name, dsl_debug_method_names[i]) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Returns the upper bound of the bucket holding the percentile, which is never above the maximum */
+static uint32_t dsl_debug_percentile(const struct dsl_debug_hist *hist, unsigned int percent)
+{
+	uint64_t rank = ((uint64_t)hist->count * percent + 99) / 100;
+	uint64_t seen = 0, upper;
+	unsigned int i;
+
+	for (i = 0; i < DSL_DEBUG_BUCKETS; i++) {
+		seen += hist->buckets[i];
+		if (seen >= rank && seen > 0)
+			break;
+	}
+	if (i == DSL_DEBUG_BUCKETS)
+		return hist->max;
+
+	upper = dsl_debug_bucket_min(i + 1) - 1;
+	return upper < hist->max ? (uint32_t)upper : hist->max;
+}
+
+static void dsl_debug_hist_to_blob(const struct dsl_debug_hist *hist, const char *name, struct blob_buf *bb)
+{
+	void *table = blobmsg_open_table(bb, name);
+
+	blobmsg_add_u32(bb, "count", hist->count);
+	blobmsg_add_u32(bb, "avg", hist->count ? (uint32_t)(hist->sum / hist->count) : 0);
+	blobmsg_add_u32(bb, "p50", dsl_debug_percentile(hist, 50));
+	blobmsg_add_u32(bb, "p90", dsl_debug_percentile(hist, 90));
+	blobmsg_add_u32(bb, "p99", dsl_debug_percentile(hist, 99));
+	blobmsg_add_u32(bb, "max", hist->max);
+	blobmsg_close_table(bb, table);
+}
+
+/**
+ * This function adds the latencies in microseconds of a method, or of all methods if method is -1,
+ * as a table per method with a table per phase.
+ */
+void dsl_debug_to_blob(int method, struct blob_buf *bb)
+{
+	void *methods, *table;
+	int i, j;
+
+	methods = blobmsg_open_table(bb, "methods");
+	for (i = 0; i < __DSL_DEBUG_METHOD_MAX; i++) {
+		if (method >= 0 && i != method)
+			continue;
+
+		table = blobmsg_open_table(bb, dsl_debug_method_names[i]);
+		for (j = 0; j < __DSL_DEBUG_PHASE_MAX; j++)
+			dsl_debug_hist_to_blob(&debug_hists[i][j], dsl_debug_phase_names[j], bb);
+		blobmsg_close_table(bb, table);
+	}
+	blobmsg_close_table(bb, methods);
+}
+
+/* Clears the latencies of a method, or of all methods if method is -1 */
+void dsl_debug_reset(int method)
+{
+	if (method < 0)
+		memset(debug_hists, 0, sizeof(debug_hists));
+	else if (method < __DSL_DEBUG_METHOD_MAX)
+		memset(debug_hists[method], 0, sizeof(debug_hists[method]));
+}
@@ -0,0 +1,421 @@
+/*
+ * dslmngr_history.c - history of the main line and channel metrics
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: anjan.chanda@iopsys.eu
+ *         yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <libubox/blobmsg.h>
+#include <libubox/uloop.h>
+#include <libubox/utils.h>
+
+#include "xdsl.h"
+#include "dslmngr.h"
+
+/* Number of samples kept per line, one day at the default period of one minute */
+#define DSL_HISTORY_SAMPLES 1440
+
+/* "DSLH" in the first bytes of a history file, written last when the file is created */
+#define DSL_HISTORY_MAGIC 0x484c5344
+#define DSL_HISTORY_VERSION 1
+
+/**
+ * struct dsl_history_field - A metric kept in the history
+ *
+ * The metrics are pairs of upstream and downstream values taken from struct dsl_line or, if
+ * channel is true, from struct dsl_channel and the total statistics of the channel.
+ */
+struct dsl_history_field {
+	const char *name;
+	bool channel;
+	bool is_signed;
+};
+
+enum {
+	DSL_HISTORY_NOISE_MARGIN,
+	DSL_HISTORY_ATTENUATION,
+	DSL_HISTORY_POWER,
+	DSL_HISTORY_MAX_BIT_RATE,
+	DSL_HISTORY_CURR_RATE,
+	DSL_HISTORY_ACTNDR,
+	DSL_HISTORY_FEC_ERRORS,
+	DSL_HISTORY_HEC_ERRORS,
+	DSL_HISTORY_CRC_ERRORS,
+	__DSL_HISTORY_FIELD_MAX,
+};
+
+static const struct dsl_history_field dsl_history_fields[__DSL_HISTORY_FIELD_MAX] = {
+	[DSL_HISTORY_NOISE_MARGIN] = { "noise_margin", false, true },
+	[DSL_HISTORY_ATTENUATION] = { "attenuation", false, true },
+	[DSL_HISTORY_POWER] = { "power", false, true },
+	[DSL_HISTORY_MAX_BIT_RATE] = { "max_bit_rate", false, false },
+	[DSL_HISTORY_CURR_RATE] = { "curr_rate", true, false },
+	[DSL_HISTORY_ACTNDR] = { "actndr", true, false },
+	[DSL_HISTORY_FEC_ERRORS] = { "fec_errors", true, false },
+	[DSL_HISTORY_HEC_ERRORS] = { "hec_errors", true, false },
+	[DSL_HISTORY_CRC_ERRORS] = { "crc_errors", true, false },
+};
+
+/**
+ * struct dsl_history_header - The header of the history file
+ *
+ * The header describes the layout of the rest of the file and is never modified once written. The
+ * checksum also covers the names of the metrics, so that a file written by a daemon recording other
+ * metrics is rebuilt rather than misread.
+ */
+struct dsl_history_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t header_size;
+	uint32_t ring_size;
+	uint32_t line_num;
+	uint32_t samples;
+	uint32_t fields;
+	uint32_t checksum;
+};
+
+/**
+ * struct dsl_history_ring - The samples of a line
+ *
+ * Each metric is stored in its own array so that a query only touches the memory of the metric it
+ * returns. The time is in seconds since the Epoch.
+ *
+ * seq is the number of samples ever written, the sample n being stored at index n % samples. A
+ * sample is valid only if slot_seq at its index is n + 1. Since a slot is cleared before and set
+ * after its sample is written, and seq is only incremented after that, a sample being written
+ * when the daemon dies is never read back.
+ */
+struct dsl_history_ring {
+	uint64_t seq;
+	uint64_t slot_seq[DSL_HISTORY_SAMPLES];
+	uint32_t time[DSL_HISTORY_SAMPLES];
+	int32_t us[__DSL_HISTORY_FIELD_MAX][DSL_HISTORY_SAMPLES];
+	int32_t ds[__DSL_HISTORY_FIELD_MAX][DSL_HISTORY_SAMPLES];
+};
+
+static struct dsl_history_ring *rings;
+static int ring_num;
+
+static struct uloop_timeout sample_timer;
+static struct dsl_cache_waiter sample_waiter;
+static bool sample_pending;
+
+static void dsl_history_values(const struct dsl_snapshot *status, const struct dsl_snapshot *stats, int field,
+		int32_t *us, int32_t *ds)
+{
+	const struct dsl_channel_stats_interval *total = NULL;
+
+	if (stats)
+		total = &stats->stats.channel_intervals[DSL_STATS_TOTAL - DSL_STATS_TOTAL];
+
+	switch (field) {
+	case DSL_HISTORY_NOISE_MARGIN:
+		*us = (int32_t)status->line.noise_margin.us;
+		*ds = (int32_t)status->line.noise_margin.ds;
+		break;
+	case DSL_HISTORY_ATTENUATION:
+		*us = (int32_t)status->line.attenuation.us;
+		*ds = (int32_t)status->line.attenuation.ds;
+		break;
+	case DSL_HISTORY_POWER:
+		*us = (int32_t)status->line.power.us;
+		*ds = (int32_t)status->line.power.ds;
+		break;
+	case DSL_HISTORY_MAX_BIT_RATE:
+		*us = (int32_t)status->line.max_bit_rate.us;
+		*ds = (int32_t)status->line.max_bit_rate.ds;
+		break;
+	case DSL_HISTORY_CURR_RATE:
+		*us = (int32_t)status->channel.curr_rate.us;
+		*ds = (int32_t)status->channel.curr_rate.ds;
+		break;
+	case DSL_HISTORY_ACTNDR:
+		*us = (int32_t)status->channel.actndr.us;
+		*ds = (int32_t)status->channel.actndr.ds;
+		break;
+	// The errors detected by the ATU-C are the upstream ones
+	case DSL_HISTORY_FEC_ERRORS:
+		*us = total ? (int32_t)total->xtuc_fec_errors : (int32_t)DSL_INVALID_STATS_COUNTER;
+		*ds = total ? (int32_t)total->xtur_fec_errors : (int32_t)DSL_INVALID_STATS_COUNTER;
+		break;
+	case DSL_HISTORY_HEC_ERRORS:
+		*us = total ? (int32_t)total->xtuc_hec_errors : (int32_t)DSL_INVALID_STATS_COUNTER;
+		*ds = total ? (int32_t)total->xtur_hec_errors : (int32_t)DSL_INVALID_STATS_COUNTER;
+		break;
+	case DSL_HISTORY_CRC_ERRORS:
+		*us = total ? (int32_t)total->xtuc_crc_errors : (int32_t)DSL_INVALID_STATS_COUNTER;
+		*ds = total ? (int32_t)total->xtur_crc_errors : (int32_t)DSL_INVALID_STATS_COUNTER;
+		break;
+	default:
+		*us = *ds = 0;
+		break;
+	}
+}
+
+static void dsl_history_sample(void)
+{
+	const struct dsl_snapshot *status, *stats;
+	struct dsl_history_ring *ring;
+	uint32_t now = (uint32_t)time(NULL);
+	unsigned int idx;
+	int i, field;
+
+	for (i = 0; i < ring_num; i++) {
+		// Nothing is recorded for a line whose data could not be retrieved
+		status = dsl_cache_peek_status(i);
+		if (!status)
+			continue;
+		stats = dsl_cache_peek_stats(i);
+
+		ring = &rings[i];
+		idx = ring->seq % DSL_HISTORY_SAMPLES;
+
+		// Invalidate the slot, write the sample, then validate the slot and publish it
+		ring->slot_seq[idx] = 0;
+		__sync_synchronize();
+		ring->time[idx] = now;
+		for (field = 0; field < __DSL_HISTORY_FIELD_MAX; field++)
+			dsl_history_values(status, stats, field, &ring->us[field][idx], &ring->ds[field][idx]);
+		__sync_synchronize();
+		ring->slot_seq[idx] = ring->seq + 1;
+		__sync_synchronize();
+		ring->seq++;
+	}
+}
+
+static void dsl_history_waiter_cb(struct dsl_cache_waiter *waiter)
+{
+	sample_pending = false;
+	dsl_history_sample();
+}
+
+static void dsl_history_timer_cb(struct uloop_timeout *t)
+{
+	uloop_timeout_set(t, dslmngr_conf.history_period * 1000);
+
+	// The previous sample is still waiting for the backend
+	if (sample_pending)
+		return;
+
+	// Take the sample from the cache, refreshing it without blocking if possible
+	switch (dsl_cache_refresh_async(&sample_waiter, -1, true, true)) {
+	case 0:
+		sample_pending = true;
+		return;
+	case -1:
+		dsl_cache_refresh(-1, true, true);
+		break;
+	default:
+		break;
+	}
+
+	dsl_history_sample();
+}
+
+/* FNV-1a hash of the header, without its checksum, and of the names of the metrics */
+static uint32_t dsl_history_checksum(const struct dsl_history_header *hdr)
+{
+	const unsigned char *p = (const unsigned char *)hdr;
+	uint32_t hash = 2166136261u;
+	size_t i;
+	int f;
+
+	for (i = 0; i < offsetof(struct dsl_history_header, checksum); i++)
+		hash = (hash ^ p[i]) * 16777619u;
+
+	for (f = 0; f < __DSL_HISTORY_FIELD_MAX; f++) {
+		for (p = (const unsigned char *)dsl_history_fields[f].name; *p; p++)
+			hash = (hash ^ *p) * 16777619u;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+static void dsl_history_fill_header(struct dsl_history_header *hdr, int max_line)
+{
+	memset(hdr, 0, sizeof(*hdr));
+	hdr->magic = DSL_HISTORY_MAGIC;
+	hdr->version = DSL_HISTORY_VERSION;
+	hdr->header_size = sizeof(struct dsl_history_header);
+	hdr->ring_size = sizeof(struct dsl_history_ring);
+	hdr->line_num = max_line;
+	hdr->samples = DSL_HISTORY_SAMPLES;
+	hdr->fields = __DSL_HISTORY_FIELD_MAX;
+	hdr->checksum = dsl_history_checksum(hdr);
+}
+
+/**
+ * This function maps the history file, reusing the samples it holds if its header matches the
+ * layout of this daemon. Otherwise, e.g. if it is truncated or corrupt, the file is rebuilt empty.
+ *
+ * @return 0 on success, -1 if the file cannot be used
+ */
+static int dsl_history_map(const char *path, int max_line)
+{
+	struct dsl_history_header expected, *hdr;
+	size_t size = sizeof(expected) + (size_t)max_line * sizeof(struct dsl_history_ring);
+	struct stat st;
+	void *addr;
+	bool reuse;
+	int fd;
+
+	fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+	if (fd < 0) {
+		DSLMNGR_LOG(LOG_ERR, "Failed to open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	dsl_history_fill_header(&expected, max_line);
+	reuse = fstat(fd, &st) == 0 && st.st_size == (off_t)size;
+	if (!reuse) {
+		// Start again from an empty file which reads as zeros
+		if (ftruncate(fd, 0) != 0 || ftruncate(fd, size) != 0) {
+			DSLMNGR_LOG(LOG_ERR, "Failed to resize %s: %s\n", path, strerror(errno));
+			close(fd);
+			return -1;
+		}
+	}
+
+	addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (addr == MAP_FAILED) {
+		DSLMNGR_LOG(LOG_ERR, "Failed to map %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	hdr = addr;
+	if (reuse && memcmp(hdr, &expected, sizeof(expected)) != 0) {
+		DSLMNGR_LOG(LOG_WARNING, "Rebuilding the corrupt or outdated history file %s\n", path);
+		memset(addr, 0, size);
+		reuse = false;
+	}
+
+	if (!reuse) {
+		// The magic is written last so that a file whose creation was interrupted is rebuilt
+		hdr->magic = 0;
+		__sync_synchronize();
+		memcpy((char *)hdr + sizeof(hdr->magic), (char *)&expected + sizeof(expected.magic),
+				sizeof(expected) - sizeof(expected.magic));
+		__sync_synchronize();
+		hdr->magic = expected.magic;
+	}
+
+	rings = (struct dsl_history_ring *)((char *)addr + sizeof(expected));
+
+	return 0;
+}
+
+int dsl_history_init(void)
+{
+	int max_line = dsl_get_line_number();
+
+	if (dslmngr_conf.history_period == 0 || max_line <= 0)
+		return 0;
+
+	if (dslmngr_conf.history_period > DSL_PERIOD_MAX) {
+		DSLMNGR_LOG(LOG_WARNING, "History period %u s too long, %u s used instead\n",
+				dslmngr_conf.history_period, DSL_PERIOD_MAX);
+		dslmngr_conf.history_period = DSL_PERIOD_MAX;
+	}
+
+	// Without a file, the history is kept in memory and lost at restart
+	if (!dslmngr_conf.history_file || !*dslmngr_conf.history_file ||
+	    dsl_history_map(dslmngr_conf.history_file, max_line) != 0) {
+		rings = calloc(max_line, sizeof(*rings));
+		if (!rings) {
+			DSLMNGR_LOG(LOG_ERR, "Out of memory\n");
+			return -1;
+		}
+	}
+	ring_num = max_line;
+
+	sample_waiter.cb = dsl_history_waiter_cb;
+	sample_timer.cb = dsl_history_timer_cb;
+	uloop_timeout_set(&sample_timer, 0);
+
+	return 0;
+}
+
+/* Adds the samples taken between start and end, their time if values is NULL */
+static void dsl_history_add_array(struct blob_buf *bb, const char *name, const struct dsl_history_ring *ring,
+		const int32_t *values, bool is_signed, uint32_t start, uint32_t end)
+{
+	void *array;
+	uint64_t seq = 0;
+	unsigned int idx;
+
+	array = blobmsg_open_array(bb, name);
+	if (ring && ring->seq > DSL_HISTORY_SAMPLES)
+		seq = ring->seq - DSL_HISTORY_SAMPLES;
+	for (; ring && seq < ring->seq; seq++) {
+		idx = seq % DSL_HISTORY_SAMPLES;
+		if (ring->slot_seq[idx] != seq + 1)
+			continue;
+		if (ring->time[idx] < start || (end != 0 && ring->time[idx] > end))
+			continue;
+
+		if (!values)
+			blobmsg_add_u32(bb, "", ring->time[idx]);
+		else if (is_signed)
+			blobmsg_add_u32(bb, "", (uint32_t)values[idx]);
+		else
+			blobmsg_add_u64(bb, "", (uint32_t)values[idx]);
+	}
+	blobmsg_close_array(bb, array);
+}
+
+/**
+ * This function adds the samples of a metric of a line taken between start and end, both in
+ * seconds since the Epoch and end being 0 for now, to the buffer.
+ *
+ * @return 0 on success, -1 if the metric is unknown or not a metric of a channel as requested
+ */
+int dsl_history_to_blob(int line_num, const char *name, bool channel, uint32_t start, uint32_t end,
+		struct blob_buf *bb)
+{
+	const struct dsl_history_ring *ring = NULL;
+	int f;
+
+	for (f = 0; f < __DSL_HISTORY_FIELD_MAX; f++) {
+		if (strcmp(name, dsl_history_fields[f].name) == 0)
+			break;
+	}
+	if (f == __DSL_HISTORY_FIELD_MAX || dsl_history_fields[f].channel != channel)
+		return -1;
+
+	if (line_num >= 0 && line_num < ring_num)
+		ring = &rings[line_num];
+
+	blobmsg_add_string(bb, "field", dsl_history_fields[f].name);
+	blobmsg_add_u32(bb, "period", dslmngr_conf.history_period);
+	dsl_history_add_array(bb, "time", ring, NULL, false, start, end);
+	dsl_history_add_array(bb, "us", ring, ring ? ring->us[f] : NULL, dsl_history_fields[f].is_signed, start, end);
+	dsl_history_add_array(bb, "ds", ring, ring ? ring->ds[f] : NULL, dsl_history_fields[f].is_signed, start, end);
+
+	return 0;
+}
@@ -0,0 +1,400 @@
+/*
+ * dslmngr_metrics.c - OpenMetrics exporter of the DSL lines
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: anjan.chanda@iopsys.eu
+ *         yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE	// memmem()
+#endif
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <libubox/uloop.h>
+#include <libubox/usock.h>
+#include <libubox/ustream.h>
+#include <libubox/utils.h>
+
+#include "dslmngr.h"
+
+/* Initial size of the rendered text, which is enough for a line and its channel */
+#define DSL_METRICS_BUF_SIZE 16384
+
+/* Maximum number of clients served at the same time, the others are refused */
+#define DSL_METRICS_CLIENT_MAX 8
+
+/* Maximum size of a request with its headers */
+#define DSL_METRICS_REQUEST_MAX 4096
+
+/* Time in milliseconds after which a client which has not been served is disconnected */
+#define DSL_METRICS_TIMEOUT 10000
+
+#define DSL_METRICS_CONTENT_TYPE "application/openmetrics-text; version=1.0.0; charset=utf-8"
+
+/** enum dsl_metrics_state - Progress of the request of a client */
+enum dsl_metrics_state {
+	DSL_METRICS_READING,	// The request is being received
+	DSL_METRICS_WAITING,	// The data are being refreshed by the worker threads
+	DSL_METRICS_WRITING,	// The reply is being sent, the connection is closed once it is sent
+};
+
+/**
+ * struct dsl_metrics_client - A connection to the metrics socket
+ *
+ * The requests are HTTP GET requests as sent by Prometheus, whatever their path. A single request
+ * is served per connection.
+ */
+struct dsl_metrics_client {
+	struct ustream_fd sfd;
+	struct uloop_timeout timeout;
+	struct dsl_cache_waiter waiter;
+	enum dsl_metrics_state state;
+};
+
+static struct uloop_fd metrics_server;
+static int client_num;
+
+/* The text is only rendered again once the data have changed, i.e. their generation */
+static struct dsl_metrics_buf metrics_buf;
+static bool metrics_valid;
+static uint32_t metrics_gen;
+
+/* Makes room for len more bytes and a terminating '\0' */
+static bool dsl_metrics_grow(struct dsl_metrics_buf *buf, size_t len)
+{
+	size_t size;
+	char *data;
+
+	if (buf->error)
+		return false;
+	if (buf->len + len < buf->size)
+		return true;
+
+	for (size = buf->size ? buf->size : DSL_METRICS_BUF_SIZE; size <= buf->len + len; size *= 2)
+		;
+	data = realloc(buf->data, size);
+	if (!data) {
+		buf->error = true;
+		return false;
+	}
+	buf->data = data;
+	buf->size = size;
+
+	return true;
+}
+
+void dsl_metrics_printf(struct dsl_metrics_buf *buf, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	if (buf->error)
+		return;
+
+	va_start(ap, fmt);
+	len = vsnprintf(buf->data ? buf->data + buf->len : NULL, buf->size - buf->len, fmt, ap);
+	va_end(ap);
+	if (len < 0) {
+		buf->error = true;
+		return;
+	}
+
+	// Formatted again once the buffer is large enough, which is rare once it has grown
+	if (buf->len + len >= buf->size) {
+		if (!dsl_metrics_grow(buf, len))
+			return;
+		va_start(ap, fmt);
+		vsnprintf(buf->data + buf->len, buf->size - buf->len, fmt, ap);
+		va_end(ap);
+	}
+	buf->len += len;
+}
+
+static void dsl_metrics_append(struct dsl_metrics_buf *buf, const char *data, size_t len)
+{
+	if (!dsl_metrics_grow(buf, len))
+		return;
+
+	memcpy(buf->data + buf->len, data, len);
+	buf->len += len;
+	buf->data[buf->len] = '\0';
+}
+
+/**
+ * This function adds a label to a sample, preceded by a comma. The backslashes, double quotes and
+ * line feeds of the value are escaped as required by OpenMetrics.
+ */
+void dsl_metrics_add_label(struct dsl_metrics_buf *buf, const char *name, const char *value)
+{
+	size_t len;
+
+	dsl_metrics_printf(buf, ",%s=\"", name);
+	for (;;) {
+		len = strcspn(value, "\\\"\n");
+		dsl_metrics_append(buf, value, len);
+		value += len;
+		if (*value == '\0')
+			break;
+
+		dsl_metrics_append(buf, *value == '\n' ? "\\n" : *value == '"' ? "\\\"" : "\\\\", 2);
+		value++;
+	}
+	dsl_metrics_append(buf, "\"", 1);
+}
+
+/* Returns the text of the current data, rendered again only if they have changed since */
+static const struct dsl_metrics_buf *dsl_metrics_get(void)
+{
+	uint32_t gen = dsl_cache_generation();
+
+	if (!metrics_valid || gen != metrics_gen) {
+		metrics_valid = dsl_metrics_render(&metrics_buf) == 0;
+		metrics_gen = gen;
+	}
+
+	return metrics_valid ? &metrics_buf : NULL;
+}
+
+static void dsl_metrics_client_close(struct dsl_metrics_client *c)
+{
+	uloop_timeout_cancel(&c->timeout);
+	ustream_free(&c->sfd.stream);
+	close(c->sfd.fd.fd);
+	free(c);
+	client_num--;
+}
+
+/* The connection is closed from notify_state() once all has been written */
+static void dsl_metrics_send(struct dsl_metrics_client *c, const char *status, const char *data,
+		size_t len)
+{
+	struct ustream *s = &c->sfd.stream;
+
+	c->state = DSL_METRICS_WRITING;
+	ustream_printf(s, "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+			status, DSL_METRICS_CONTENT_TYPE, len);
+	if (len)
+		ustream_write(s, data, (int)len, false);
+
+	if (s->w.data_bytes == 0)
+		ustream_state_change(s);
+}
+
+static void dsl_metrics_reply(struct dsl_metrics_client *c)
+{
+	const struct dsl_metrics_buf *buf = dsl_metrics_get();
+
+	if (buf)
+		dsl_metrics_send(c, "200 OK", buf->data, buf->len);
+	else
+		dsl_metrics_send(c, "503 Service Unavailable", NULL, 0);
+}
+
+static void dsl_metrics_waiter_cb(struct dsl_cache_waiter *waiter)
+{
+	struct dsl_metrics_client *c = container_of(waiter, struct dsl_metrics_client, waiter);
+
+	dsl_metrics_reply(c);
+}
+
+/**
+ * This function replies to a request once the data of all lines are fresh. The data which are not
+ * are refreshed by the worker threads, as for a UBUS request.
+ */
+static void dsl_metrics_request(struct dsl_metrics_client *c)
+{
+	c->waiter.cb = dsl_metrics_waiter_cb;
+	switch (dsl_cache_refresh_async(&c->waiter, -1, true, true)) {
+	case 0:
+		c->state = DSL_METRICS_WAITING;
+		return;
+	case -1:
+		// No worker thread or too many pending requests, call the backend from here
+		dsl_cache_refresh(-1, true, true);
+		break;
+	default:
+		break;
+	}
+
+	dsl_metrics_reply(c);
+}
+
+static void dsl_metrics_read_cb(struct ustream *s, int bytes)
+{
+	struct dsl_metrics_client *c = container_of(s, struct dsl_metrics_client, sfd.stream);
+	char *data;
+	int len;
+	bool get;
+
+	data = ustream_get_read_buf(s, &len);
+	if (!data)
+		return;
+
+	// Anything sent after the request is ignored
+	if (c->state != DSL_METRICS_READING) {
+		ustream_consume(s, len);
+		return;
+	}
+
+	// The request ends with an empty line
+	if (!memmem(data, len, "\r\n\r\n", 4) && !memmem(data, len, "\n\n", 2)) {
+		if (s->r.data_bytes >= DSL_METRICS_REQUEST_MAX)
+			dsl_metrics_send(c, "413 Request Entity Too Large", NULL, 0);
+		return;
+	}
+
+	get = len >= 4 && memcmp(data, "GET ", 4) == 0;
+	ustream_consume(s, len);
+
+	if (get)
+		dsl_metrics_request(c);
+	else
+		dsl_metrics_send(c, "405 Method Not Allowed", NULL, 0);
+}
+
+static void dsl_metrics_write_cb(struct ustream *s, int bytes)
+{
+	struct dsl_metrics_client *c = container_of(s, struct dsl_metrics_client, sfd.stream);
+
+	if (c->state == DSL_METRICS_WRITING && s->w.data_bytes == 0)
+		ustream_state_change(s);
+}
+
+static void dsl_metrics_state_cb(struct ustream *s)
+{
+	struct dsl_metrics_client *c = container_of(s, struct dsl_metrics_client, sfd.stream);
+
+	// The waiter is only released by the cache once the data are refreshed
+	if (c->state == DSL_METRICS_WAITING)
+		return;
+
+	if (s->write_error || (c->state == DSL_METRICS_READING && s->eof) ||
+		(c->state == DSL_METRICS_WRITING && s->w.data_bytes == 0))
+		dsl_metrics_client_close(c);
+}
+
+static void dsl_metrics_timeout_cb(struct uloop_timeout *t)
+{
+	struct dsl_metrics_client *c = container_of(t, struct dsl_metrics_client, timeout);
+
+	if (c->state == DSL_METRICS_WAITING) {
+		uloop_timeout_set(t, DSL_METRICS_TIMEOUT);
+		return;
+	}
+
+	dsl_metrics_client_close(c);
+}
+
+static void dsl_metrics_accept_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct dsl_metrics_client *c;
+	int sfd;
+
+	// The connections are made non-blocking by uloop as the listening socket is
+	while ((sfd = accept(fd->fd, NULL, NULL)) >= 0) {
+		c = client_num < DSL_METRICS_CLIENT_MAX ? calloc(1, sizeof(*c)) : NULL;
+		if (!c) {
+			close(sfd);
+			continue;
+		}
+
+		c->state = DSL_METRICS_READING;
+		c->sfd.stream.notify_read = dsl_metrics_read_cb;
+		c->sfd.stream.notify_write = dsl_metrics_write_cb;
+		c->sfd.stream.notify_state = dsl_metrics_state_cb;
+		ustream_fd_init(&c->sfd, sfd);
+
+		c->timeout.cb = dsl_metrics_timeout_cb;
+		uloop_timeout_set(&c->timeout, DSL_METRICS_TIMEOUT);
+		client_num++;
+	}
+}
+
+/**
+ * This function opens the listening socket, a unix socket if addr is a path and otherwise a TCP
+ * socket on [host:]port, e.g. "9100", "127.0.0.1:9100" or "[::1]:9100".
+ */
+static int dsl_metrics_listen(const char *addr)
+{
+	const char *port;
+	char host[64] = "127.0.0.1";
+	struct stat st;
+	size_t len;
+
+	if (addr[0] == '/') {
+		// A socket left by a previous instance is replaced, any other file is kept
+		if (lstat(addr, &st) == 0 && S_ISSOCK(st.st_mode))
+			unlink(addr);
+		return usock(USOCK_UNIX | USOCK_SERVER | USOCK_NONBLOCK, addr, NULL);
+	}
+
+	port = strrchr(addr, ':');
+	if (port) {
+		len = port - addr;
+		if (len >= 2 && addr[0] == '[' && addr[len - 1] == ']') {
+			addr++;
+			len -= 2;
+		}
+		if (len >= sizeof(host))
+			return -1;
+		if (len > 0) {
+			memcpy(host, addr, len);
+			host[len] = '\0';
+		}
+		port++;
+	} else {
+		port = addr;
+	}
+
+	return usock(USOCK_TCP | USOCK_SERVER | USOCK_NONBLOCK, host, port);
+}
+
+/**
+ * This function starts serving the metrics on addr, as described for dslmngr_config.metrics_addr.
+ * Nothing is served if addr is NULL or empty.
+ *
+ * @return 0 on success, -1 if the socket could not be opened
+ */
+int dsl_metrics_init(const char *addr)
+{
+	int fd;
+
+	if (!addr || addr[0] == '\0')
+		return 0;
+
+	fd = dsl_metrics_listen(addr);
+	if (fd < 0) {
+		DSLMNGR_LOG(LOG_ERR, "Failed to listen for metrics on %s\n", addr);
+		return -1;
+	}
+
+	// A client closing its connection while being written to must not stop the daemon
+	signal(SIGPIPE, SIG_IGN);
+
+	metrics_server.fd = fd;
+	metrics_server.cb = dsl_metrics_accept_cb;
+	uloop_fd_add(&metrics_server, ULOOP_READ);
+
+	return 0;
+}
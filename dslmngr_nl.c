@@ -22,6 +22,7 @@
  */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <signal.h>
 #include <netlink/netlink.h>
@@ -30,8 +31,11 @@
 #include <netlink/genl/genl.h>
 #include <netlink/attr.h>
 #include "libubox/blobmsg_json.h"
+#include "libubox/uloop.h"
 #include "libubus.h"
 
+#include "dslmngr.h"
+
 #define NETLINK_FAMILY_NAME "easysoc"
 #define NETLINK_GROUP_NAME  "notify"
 
@@ -50,13 +54,46 @@ static struct nla_policy nl_notify_policy[__XDSL_NL_MAX] = {
 
 static struct nlattr *attrs[__XDSL_NL_MAX];
 
+/* Attributes of the DSL driver notifications */
+enum {
+	DSL_EVENT_LINE,
+	__DSL_EVENT_MAX,
+};
+
+static const struct blobmsg_policy dsl_event_policy[__DSL_EVENT_MAX] = {
+	[DSL_EVENT_LINE] = { .name = "line", .type = BLOBMSG_TYPE_INT32 },
+};
+
+/**
+ * This function refreshes the cached data of the line a DSL driver notification, e.g. link up or
+ * down, retrain or profile change, refers to. All lines are refreshed if it does not tell which.
+ */
+static void dslmngr_nl_dsl_event(const char *event, struct blob_attr *data)
+{
+	struct blob_attr *tb[__DSL_EVENT_MAX];
+	int line_num = -1;
+
+	// Other drivers notify on the same netlink group
+	if (!strstr(event, "dsl"))
+		return;
+
+	blobmsg_parse(dsl_event_policy, __DSL_EVENT_MAX, tb, blob_data(data), blob_len(data));
+	if (tb[DSL_EVENT_LINE])
+		line_num = (int)blobmsg_get_u32(tb[DSL_EVENT_LINE]);
+
+	dsl_cache_update(line_num);
+}
+
 static int dslmngr_ubus_event(struct ubus_context *ctx, char *message)
 {
 	static struct blob_buf b;
 	char event[32];
 	char data[128];
 
-	sscanf(message, "%s '%[^\n]s'", event, data);
+	if (sscanf(message, "%31s '%127[^\n]s'", event, data) != 2) {
+		fprintf(stderr, "Failed to parse message: %s\n", message);
+		return -1;
+	}
 
 	blob_buf_init(&b, 0);
 
@@ -65,6 +102,8 @@ static int dslmngr_ubus_event(struct ubus_context *ctx, char *message)
 		return -1;
 	}
 
+	dslmngr_nl_dsl_event(event, b.head);
+
 	return ubus_send_event(ctx, event, b.head);
 }
 
@@ -90,7 +129,53 @@ static int dslmngr_nl_to_ubus_event(struct nl_msg *msg, void *arg)
 	return 0;
 }
 
-int dslmngr_nl_msgs_handler(struct ubus_context *ctx)
+static struct {
+	struct nl_sock *sock;
+	struct nl_cb *cb;
+	struct uloop_fd ufd;
+} nl;
+
+/**
+ * This function is called when the socket receive buffer has overflowed. The notifications lost
+ * can not be retrieved, so the cached data are refreshed from the driver instead.
+ */
+static void dslmngr_nl_resync(void)
+{
+	fprintf(stderr, "Netlink notifications lost, resynchronizing\n");
+	dsl_cache_update(-1);
+}
+
+static void dslmngr_nl_recv_cb(struct uloop_fd *ufd, unsigned int events)
+{
+	int err;
+
+	// Drain all pending messages in one go since uloop only reports the socket as readable
+	for (;;) {
+		err = nl_recvmsgs_report(nl.sock, nl.cb);
+		if (err > 0)
+			continue;
+		if (err == 0 || err == -NLE_AGAIN)
+			break;
+
+		// libnl reports ENOBUFS as NLE_NOMEM
+		if (err == -NLE_NOMEM) {
+			dslmngr_nl_resync();
+			continue;
+		}
+
+		fprintf(stderr, "Error: %s (%s grp %s)\n",
+				nl_geterror(err),
+				NETLINK_FAMILY_NAME,
+				NETLINK_GROUP_NAME);
+		break;
+	}
+}
+
+/**
+ * This function subscribes to the driver notifications and registers the netlink socket with
+ * uloop. The notifications are converted to UBUS events from the main loop.
+ */
+int dslmngr_nl_init(struct ubus_context *ctx)
 {
 	struct nl_sock *sock;
 	int grp;
@@ -108,26 +193,40 @@ int dslmngr_nl_msgs_handler(struct ubus_context *ctx)
 
 	if ((err = genl_connect(sock)) < 0){
 		fprintf(stderr, "Error: %s\n", nl_geterror(err));
-		return -1;
+		goto __error;
 	}
 
 	if ((grp = genl_ctrl_resolve_grp(sock,
 					NETLINK_FAMILY_NAME,
 					NETLINK_GROUP_NAME)) < 0) {
-		return -1;
+		fprintf(stderr, "Error: %s (%s grp %s)\n",
+				nl_geterror(grp),
+				NETLINK_FAMILY_NAME,
+				NETLINK_GROUP_NAME);
+		goto __error;
 	}
 
-	nl_socket_add_membership(sock, grp);
+	if ((err = nl_socket_add_membership(sock, grp)) < 0 ||
+		(err = nl_socket_set_nonblocking(sock)) < 0) {
+		fprintf(stderr, "Error: %s\n", nl_geterror(err));
+		goto __error;
+	}
 
-	while (1) {
-		err = nl_recvmsgs_default(sock);
-		if (err < 0) {
-			fprintf(stderr, "Error: %s (%s grp %s)\n",
-					nl_geterror(err),
-					NETLINK_FAMILY_NAME,
-					NETLINK_GROUP_NAME);
-		}
+	nl.sock = sock;
+	nl.cb = nl_socket_get_cb(sock);
+	nl.ufd.fd = nl_socket_get_fd(sock);
+	nl.ufd.cb = dslmngr_nl_recv_cb;
+	if (uloop_fd_add(&nl.ufd, ULOOP_READ) != 0) {
+		fprintf(stderr, "Error: failed to add the netlink socket to uloop\n");
+		nl_cb_put(nl.cb);
+		nl.sock = NULL;
+		nl.cb = NULL;
+		goto __error;
 	}
 
 	return 0;
+
+__error:
+	nl_socket_free(sock);
+	return -1;
 }
@@ -0,0 +1,134 @@
+/*
+ * dslmngr_rate.c - error rates of the DSL lines and channels
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: anjan.chanda@iopsys.eu
+ *         yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <math.h>
+#include <libubox/blobmsg.h>
+#include <libubox/utils.h>
+
+#include "xdsl.h"
+#include "dslmngr.h"
+
+/* Time constants in seconds of the moving averages */
+#define DSL_RATE_TAU_1MIN 60.0
+#define DSL_RATE_TAU_15MIN 900.0
+
+/** struct dsl_rate_counter - A counter whose rate is computed and whether it is a channel's */
+struct dsl_rate_counter {
+	const char *name;
+	bool channel;
+};
+
+static const struct dsl_rate_counter dsl_rate_counters[__DSL_RATE_MAX] = {
+	[DSL_RATE_ERRORED_SECS] = { "errored_secs", false },
+	[DSL_RATE_SEVERELY_ERRORED_SECS] = { "severely_errored_secs", false },
+	[DSL_RATE_XTUR_FEC_ERRORS] = { "xtur_fec_errors", true },
+	[DSL_RATE_XTUC_FEC_ERRORS] = { "xtuc_fec_errors", true },
+	[DSL_RATE_XTUR_HEC_ERRORS] = { "xtur_hec_errors", true },
+	[DSL_RATE_XTUC_HEC_ERRORS] = { "xtuc_hec_errors", true },
+	[DSL_RATE_XTUR_CRC_ERRORS] = { "xtur_crc_errors", true },
+	[DSL_RATE_XTUC_CRC_ERRORS] = { "xtuc_crc_errors", true },
+};
+
+/* Counters of the Total interval, which are never reset unlike those of the Showtime interval */
+static void dsl_rate_counter_values(const struct dsl_stats_wide *wide, uint64_t values[__DSL_RATE_MAX])
+{
+	const struct dsl_line_stats_wide *line = &wide->line_intervals[DSL_STATS_TOTAL - DSL_STATS_TOTAL];
+	const struct dsl_channel_stats_wide *channel = &wide->channel_intervals[DSL_STATS_TOTAL - DSL_STATS_TOTAL];
+
+	values[DSL_RATE_ERRORED_SECS] = line->errored_secs;
+	values[DSL_RATE_SEVERELY_ERRORED_SECS] = line->severely_errored_secs;
+	values[DSL_RATE_XTUR_FEC_ERRORS] = channel->xtur_fec_errors;
+	values[DSL_RATE_XTUC_FEC_ERRORS] = channel->xtuc_fec_errors;
+	values[DSL_RATE_XTUR_HEC_ERRORS] = channel->xtur_hec_errors;
+	values[DSL_RATE_XTUC_HEC_ERRORS] = channel->xtuc_hec_errors;
+	values[DSL_RATE_XTUR_CRC_ERRORS] = channel->xtur_crc_errors;
+	values[DSL_RATE_XTUC_CRC_ERRORS] = channel->xtuc_crc_errors;
+}
+
+/**
+ * This function updates the rates with two successive reads of the 64-bit counters taken elapsed
+ * milliseconds apart. The moving averages are exponentially weighted by the time elapsed, so that
+ * irregular reads are weighted by the time they cover, and only the previous averages are needed.
+ */
+void dsl_rates_update(struct dsl_stats_rates *rates, const struct dsl_stats_wide *prev,
+		const struct dsl_stats_wide *curr, unsigned int elapsed)
+{
+	uint64_t prev_values[__DSL_RATE_MAX], curr_values[__DSL_RATE_MAX];
+	double secs = elapsed / 1000.0, w1, w15;
+	struct dsl_rate *rate;
+	int i;
+
+	// Two reads in the same millisecond tell nothing about the rates
+	if (elapsed == 0)
+		return;
+
+	dsl_rate_counter_values(prev, prev_values);
+	dsl_rate_counter_values(curr, curr_values);
+
+	w1 = 1.0 - exp(-secs / DSL_RATE_TAU_1MIN);
+	w15 = 1.0 - exp(-secs / DSL_RATE_TAU_15MIN);
+	for (i = 0; i < __DSL_RATE_MAX; i++) {
+		rate = &rates->rates[i];
+		rate->instant = (double)(curr_values[i] - prev_values[i]) / secs;
+
+		// The averages start from the first rate rather than from 0
+		if (!rates->valid) {
+			rate->avg_1min = rate->instant;
+			rate->avg_15min = rate->instant;
+		} else {
+			rate->avg_1min += w1 * (rate->instant - rate->avg_1min);
+			rate->avg_15min += w15 * (rate->instant - rate->avg_15min);
+		}
+	}
+	rates->valid = true;
+}
+
+/**
+ * This function adds the rates of the counters of a line, or of its channel if channel is true,
+ * to the buffer.
+ *
+ * @return 0 on success, -1 if the rates are not known yet, i.e. the statistics have been read
+ *         less than twice
+ */
+int dsl_rates_to_blob(const struct dsl_stats_rates *rates, bool channel, struct blob_buf *bb)
+{
+	const struct dsl_rate *rate;
+	void *table;
+	int i;
+
+	if (!rates->valid)
+		return -1;
+
+	for (i = 0; i < __DSL_RATE_MAX; i++) {
+		if (dsl_rate_counters[i].channel != channel)
+			continue;
+
+		rate = &rates->rates[i];
+		table = blobmsg_open_table(bb, dsl_rate_counters[i].name);
+		blobmsg_add_double(bb, "instant", rate->instant);
+		blobmsg_add_double(bb, "avg_1min", rate->avg_1min);
+		blobmsg_add_double(bb, "avg_15min", rate->avg_15min);
+		blobmsg_close_table(bb, table);
+	}
+
+	return 0;
+}
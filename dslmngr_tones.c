@@ -0,0 +1,402 @@
+/*
+ * dslmngr_tones.c - per-tone data of the DSL lines
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: anjan.chanda@iopsys.eu
+ *         yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <libubox/blobmsg.h>
+#include <libubox/utils.h>
+
+#include "xdsl.h"
+#include "dslmngr.h"
+
+/* Tolerance in seconds on the beginning of showtime, which is rounded by the backend */
+#define DSL_TONES_SHOWTIME_SLACK 2
+
+/** struct dsl_tones_type_desc - Name of a type of per-tone data and bytes per encoded value */
+struct dsl_tones_type_desc {
+	const char *name;
+	unsigned int width;
+};
+
+static const struct dsl_tones_type_desc dsl_tones_types[__DSL_TONES_MAX] = {
+	[DSL_TONES_BITS] = { "bits", 1 },
+	[DSL_TONES_SNR] = { "snr", 1 },
+	[DSL_TONES_QLN] = { "qln", 1 },
+	[DSL_TONES_HLOG] = { "hlog", 2 },
+};
+
+/**
+ * struct dsl_tones_entry - Cached per-tone data of one type and direction
+ *
+ * The data are kept for the whole showtime in which they were read, which is identified by the
+ * monotonic time at which it began.
+ */
+struct dsl_tones_entry {
+	bool valid;
+	time_t showtime_begin;
+	struct dsl_tones tones;
+};
+
+/**
+ * struct dsl_tones_job - Read of one type and direction run by a worker thread
+ *
+ * The data are read into the entry, which is not accessed by the main thread while the job is busy.
+ */
+struct dsl_tones_job {
+	struct dsl_job job;
+	int line_num;
+	enum dsl_tones_type type;
+	bool upstream;
+	/** Whether an asynchronous read is in progress */
+	bool busy;
+	/** Beginning of the showtime for which the data are read */
+	time_t showtime_begin;
+	int ret;
+	struct dsl_tones *tones;
+};
+
+/**
+ * struct dsl_line_tones - Cached per-tone data of a line, indexed by type and by upstream
+ *
+ * Requests arriving while the data are being read asynchronously wait for the same job.
+ */
+struct dsl_line_tones {
+	struct dsl_tones_entry entries[__DSL_TONES_MAX][2];
+	struct dsl_tones_job jobs[__DSL_TONES_MAX][2];
+};
+
+/* Allocated on first use, since the data are large and only read for troubleshooting */
+static struct dsl_line_tones *line_tones[XDSL_MAX_LINES];
+
+/* Encoded values of one type and direction, only used by the main thread */
+static unsigned char tones_data[DSL_MAX_TONES * 2];
+
+/* Upper bound of the waiters so that a burst of requests cannot exhaust the memory */
+#define DSL_TONES_WAITER_MAX 64
+
+static LIST_HEAD(waiters);
+static int waiter_num;
+
+/* Thread safe, it only calls the backend and writes the entry which the main thread waits for */
+static void dsl_tones_job_run(struct dsl_job *job)
+{
+	struct dsl_tones_job *tj = container_of(job, struct dsl_tones_job, job);
+
+	tj->ret = (*xdsl_ops.get_line_tones)(tj->line_num, tj->type, tj->upstream, tj->tones);
+	if (tj->ret == 0 && (tj->tones->group_size == 0 || tj->tones->count > DSL_MAX_TONES))
+		tj->ret = -1;
+}
+
+int dsl_tones_type(const char *name)
+{
+	int i;
+
+	for (i = 0; i < __DSL_TONES_MAX; i++) {
+		if (strcasecmp(name, dsl_tones_types[i].name) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+/* Monotonic time in seconds at which the current showtime of a line began */
+static time_t dsl_tones_showtime_begin(const struct dsl_snapshot *snap)
+{
+	return snap->stats_ts.tv_sec - (time_t)snap->stats.line.showtime_start;
+}
+
+/* Per-tone data of a line, allocated on first use */
+static struct dsl_line_tones *dsl_tones_line(int line_num)
+{
+	if (xdsl_ops.get_line_tones == NULL || line_num < 0 || line_num >= XDSL_MAX_LINES)
+		return NULL;
+
+	if (!line_tones[line_num])
+		line_tones[line_num] = calloc(1, sizeof(*line_tones[line_num]));
+
+	return line_tones[line_num];
+}
+
+/* Whether the data of an entry have been read for the showtime which began at showtime_begin */
+static bool dsl_tones_cached(const struct dsl_tones_entry *entry, time_t showtime_begin)
+{
+	time_t diff = entry->showtime_begin - showtime_begin;
+
+	return entry->valid && diff <= DSL_TONES_SHOWTIME_SLACK && diff >= -DSL_TONES_SHOWTIME_SLACK;
+}
+
+static void dsl_tones_job_init(struct dsl_tones_job *tj, struct dsl_line_tones *lt, int line_num,
+		int type, int dir, time_t showtime_begin)
+{
+	tj->job.run = dsl_tones_job_run;
+	tj->line_num = line_num;
+	tj->type = type;
+	tj->upstream = dir;
+	tj->showtime_begin = showtime_begin;
+	tj->tones = &lt->entries[type][dir].tones;
+}
+
+static void dsl_tones_commit(struct dsl_line_tones *lt, const struct dsl_tones_job *tj)
+{
+	struct dsl_tones_entry *entry = &lt->entries[tj->type][tj->upstream];
+
+	entry->valid = tj->ret == 0;
+	entry->showtime_begin = tj->showtime_begin;
+}
+
+/**
+ * This function reads the selected per-tone data which are not cached for the current showtime,
+ * which the statistics of the snapshot tell. The reads are run in parallel by the worker threads
+ * while the caller is blocked. Data being read asynchronously are left as they are.
+ */
+void dsl_tones_refresh(int line_num, const struct dsl_snapshot *snap, const struct dsl_tones_request *req)
+{
+	struct dsl_tones_job jobs[__DSL_TONES_MAX * 2];
+	struct dsl_job *job_list[__DSL_TONES_MAX * 2];
+	struct dsl_line_tones *lt;
+	time_t showtime_begin = dsl_tones_showtime_begin(snap);
+	int type, dir, i, num = 0;
+
+	lt = dsl_tones_line(line_num);
+	if (!lt)
+		return;
+
+	for (type = 0; type < __DSL_TONES_MAX; type++) {
+		if (!(req->types & (1U << type)))
+			continue;
+
+		for (dir = 0; dir < 2; dir++) {
+			if (!(dir ? req->us : req->ds) || lt->jobs[type][dir].busy ||
+				dsl_tones_cached(&lt->entries[type][dir], showtime_begin))
+				continue;
+
+			dsl_tones_job_init(&jobs[num], lt, line_num, type, dir, showtime_begin);
+			job_list[num] = &jobs[num].job;
+			num++;
+		}
+	}
+
+	dsl_worker_run(job_list, num);
+
+	for (i = 0; i < num; i++)
+		dsl_tones_commit(lt, &jobs[i]);
+}
+
+/* Called in the main thread when an asynchronous read is finished */
+static void dsl_tones_job_done(struct dsl_job *job)
+{
+	struct dsl_tones_job *tj = container_of(job, struct dsl_tones_job, job);
+	struct dsl_tones_waiter *w, *tmp;
+	uint32_t bit = 1U << (tj->type * 2 + tj->upstream);
+
+	dsl_tones_commit(line_tones[tj->line_num], tj);
+	tj->busy = false;
+
+	list_for_each_entry_safe(w, tmp, &waiters, list) {
+		if (w->line_num != tj->line_num)
+			continue;
+
+		w->entries &= ~bit;
+		if (w->entries)
+			continue;
+
+		list_del(&w->list);
+		waiter_num--;
+		w->cb(w);
+	}
+}
+
+/**
+ * This function reads the selected per-tone data which are not cached for the current showtime,
+ * which the statistics of the snapshot tell, in the worker threads without blocking the caller.
+ * waiter->cb() is called in the main thread once all of them have been read. Data already being
+ * read are not read a second time, the waiter is completed together with the pending read instead.
+ *
+ * @return 0 if the waiter will be called, 1 if there is nothing to read and -1 if the data can not
+ *         be read asynchronously, e.g. because there is no worker thread or too many waiters
+ */
+int dsl_tones_refresh_async(struct dsl_tones_waiter *waiter, int line_num, const struct dsl_snapshot *snap,
+		const struct dsl_tones_request *req)
+{
+	struct dsl_line_tones *lt;
+	struct dsl_tones_job *tj;
+	time_t showtime_begin = dsl_tones_showtime_begin(snap);
+	int type, dir;
+
+	if (waiter_num >= DSL_TONES_WAITER_MAX)
+		return -1;
+
+	// Nothing can be read, which the reply tells
+	lt = dsl_tones_line(line_num);
+	if (!lt)
+		return 1;
+
+	waiter->line_num = line_num;
+	waiter->entries = 0;
+	for (type = 0; type < __DSL_TONES_MAX; type++) {
+		if (!(req->types & (1U << type)))
+			continue;
+
+		for (dir = 0; dir < 2; dir++) {
+			tj = &lt->jobs[type][dir];
+			if (!(dir ? req->us : req->ds))
+				continue;
+
+			if (!tj->busy) {
+				if (dsl_tones_cached(&lt->entries[type][dir], showtime_begin))
+					continue;
+
+				dsl_tones_job_init(tj, lt, line_num, type, dir, showtime_begin);
+				tj->job.done = dsl_tones_job_done;
+				if (dsl_worker_submit(&tj->job) != 0)
+					return -1;
+				tj->busy = true;
+			}
+			waiter->entries |= 1U << (type * 2 + dir);
+		}
+	}
+
+	if (!waiter->entries)
+		return 1;
+
+	list_add_tail(&waiter->list, &waiters);
+	waiter_num++;
+
+	return 0;
+}
+
+/* Values are encoded in little endian with the width of their type */
+static void dsl_tones_encode(unsigned char *data, const uint16_t *values, unsigned int count,
+		unsigned int width)
+{
+	unsigned int i;
+
+	if (width == 1) {
+		for (i = 0; i < count; i++)
+			data[i] = (unsigned char)values[i];
+	} else {
+		for (i = 0; i < count; i++) {
+			data[2 * i] = (unsigned char)values[i];
+			data[2 * i + 1] = (unsigned char)(values[i] >> 8);
+		}
+	}
+}
+
+static void dsl_tones_hex(char *str, const unsigned char *data, unsigned int len)
+{
+	static const char hex_digits[] = "0123456789abcdef";
+	unsigned int i;
+
+	for (i = 0; i < len; i++) {
+		*str++ = hex_digits[data[i] >> 4];
+		*str++ = hex_digits[data[i] & 0x0f];
+	}
+	*str = '\0';
+}
+
+/* Adds the values of the groups including the tones req->start to req->end */
+static void dsl_tones_entry_to_blob(const struct dsl_tones *tones, const struct dsl_tones_request *req,
+		unsigned int width, const char *name, struct blob_buf *bb)
+{
+	unsigned int first, last, count, len;
+	void *table;
+	char *str;
+
+	first = req->start / tones->group_size;
+	last = req->end / tones->group_size;
+	if (last >= tones->count)
+		last = tones->count - 1;
+	count = first <= last && first < tones->count ? last - first + 1 : 0;
+	len = count * width;
+
+	table = blobmsg_open_table(bb, name);
+	blobmsg_add_u32(bb, "group_size", tones->group_size);
+	blobmsg_add_u32(bb, "start", first);
+	blobmsg_add_u32(bb, "count", count);
+	blobmsg_add_u32(bb, "width", width);
+
+	dsl_tones_encode(tones_data, tones->values + first, count, width);
+	if (req->hex) {
+		str = blobmsg_alloc_string_buffer(bb, "data", len * 2 + 1);
+		if (str) {
+			dsl_tones_hex(str, tones_data, len);
+			blobmsg_add_string_buffer(bb);
+		}
+	} else {
+		blobmsg_add_field(bb, BLOBMSG_TYPE_UNSPEC, "data", tones_data, len);
+	}
+	blobmsg_close_table(bb, table);
+}
+
+/**
+ * This function adds the selected per-tone data of a line to a blob buffer, a table per type with
+ * a table per direction. The values are packed in binary, or in hex for JSON clients, instead of
+ * being added one by one. The data must have been read by dsl_tones_refresh() or
+ * dsl_tones_refresh_async() beforehand.
+ *
+ * @return 0 on success, -1 if none of the data could be read and -2 if the backend does not provide
+ *         them
+ */
+int dsl_tones_to_blob(int line_num, const struct dsl_tones_request *req, struct blob_buf *bb)
+{
+	static const char * const dir_names[] = { "ds", "us" };
+	struct dsl_line_tones *lt;
+	const struct dsl_tones_entry *entry;
+	int type, dir, added = 0;
+	bool opened;
+	void *table = NULL;
+
+	if (xdsl_ops.get_line_tones == NULL)
+		return -2;
+
+	lt = dsl_tones_line(line_num);
+	if (!lt)
+		return -1;
+
+	for (type = 0; type < __DSL_TONES_MAX; type++) {
+		if (!(req->types & (1U << type)))
+			continue;
+
+		opened = false;
+		for (dir = 0; dir < 2; dir++) {
+			// Data still being read by a worker thread are not accessed
+			entry = &lt->entries[type][dir];
+			if (!(dir ? req->us : req->ds) || !entry->valid || lt->jobs[type][dir].busy)
+				continue;
+
+			// Types of which no direction could be read are left out
+			if (!opened) {
+				table = blobmsg_open_table(bb, dsl_tones_types[type].name);
+				opened = true;
+			}
+			dsl_tones_entry_to_blob(&entry->tones, req, dsl_tones_types[type].width, dir_names[dir], bb);
+			added++;
+		}
+		if (opened)
+			blobmsg_close_table(bb, table);
+	}
+
+	return added ? 0 : -1;
+}
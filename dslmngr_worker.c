@@ -0,0 +1,257 @@
+/*
+ * dslmngr_worker.c - worker threads calling the DSL backend in parallel
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: anjan.chanda@iopsys.eu
+ *         yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <libubox/list.h>
+#include <libubox/uloop.h>
+
+#include "dslmngr.h"
+
+static struct {
+	pthread_mutex_t lock;
+	/** Signalled when a job is queued */
+	pthread_cond_t queued;
+	/** Signalled when a job of a batch is finished */
+	pthread_cond_t finished;
+	struct list_head queue;
+	/** Finished asynchronous jobs waiting for their done() to be called by the main thread */
+	struct list_head done;
+	/** Written by the workers to wake the main thread up when a job is added to done */
+	int notify_fd;
+	struct uloop_fd notify;
+	pthread_t *threads;
+	int thread_num;
+} workers = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.queued = PTHREAD_COND_INITIALIZER,
+	.finished = PTHREAD_COND_INITIALIZER,
+	.queue = LIST_HEAD_INIT(workers.queue),
+	.done = LIST_HEAD_INIT(workers.done),
+	.notify_fd = -1
+};
+
+/* Hands a finished asynchronous job back to the main thread */
+static void dsl_worker_hand_back(struct dsl_job *job)
+{
+	bool wakeup;
+
+	pthread_mutex_lock(&workers.lock);
+	wakeup = list_empty(&workers.done);
+	list_add_tail(&job->list, &workers.done);
+	pthread_mutex_unlock(&workers.lock);
+
+	// One byte is enough for all the jobs finished before the main thread drains the list
+	if (wakeup && write(workers.notify_fd, "", 1) < 0 && errno != EAGAIN)
+		DSLMNGR_LOG(LOG_ERR, "Failed to wake up the main thread, %s\n", strerror(errno));
+}
+
+static void *dsl_worker_main(void *arg)
+{
+	struct dsl_job *job;
+
+	for (;;) {
+		pthread_mutex_lock(&workers.lock);
+		while (list_empty(&workers.queue))
+			pthread_cond_wait(&workers.queued, &workers.lock);
+		job = list_first_entry(&workers.queue, struct dsl_job, list);
+		list_del(&job->list);
+		pthread_mutex_unlock(&workers.lock);
+
+		job->run(job);
+
+		if (job->pending == NULL) {
+			// An asynchronous job
+			dsl_worker_hand_back(job);
+			continue;
+		}
+
+		pthread_mutex_lock(&workers.lock);
+		if (--(*job->pending) == 0)
+			pthread_cond_broadcast(&workers.finished);
+		pthread_mutex_unlock(&workers.lock);
+	}
+
+	return NULL;
+}
+
+static void dsl_worker_notify_cb(struct uloop_fd *fd, unsigned int events)
+{
+	struct list_head done = LIST_HEAD_INIT(done);
+	struct dsl_job *job, *tmp;
+	char buf[16];
+
+	while (read(fd->fd, buf, sizeof(buf)) > 0)
+		;
+
+	pthread_mutex_lock(&workers.lock);
+	list_splice_init(&workers.done, &done);
+	pthread_mutex_unlock(&workers.lock);
+
+	list_for_each_entry_safe(job, tmp, &done, list) {
+		list_del(&job->list);
+		job->done(job);
+	}
+}
+
+static int dsl_worker_notify_init(void)
+{
+	int fds[2], i;
+
+	if (pipe(fds) != 0) {
+		DSLMNGR_LOG(LOG_ERR, "Failed to create the notification pipe, %s\n", strerror(errno));
+		return -1;
+	}
+	for (i = 0; i < 2; i++) {
+		fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+		fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+	}
+
+	workers.notify_fd = fds[1];
+	workers.notify.fd = fds[0];
+	workers.notify.cb = dsl_worker_notify_cb;
+	if (uloop_fd_add(&workers.notify, ULOOP_READ) != 0) {
+		DSLMNGR_LOG(LOG_ERR, "Failed to add the notification pipe to uloop\n");
+		close(fds[0]);
+		close(fds[1]);
+		workers.notify_fd = -1;
+		return -1;
+	}
+
+	return 0;
+}
+
+int dsl_worker_init(int thread_num)
+{
+	int i;
+
+	if (thread_num <= 0)
+		return 0;
+
+	if (workers.notify_fd < 0 && dsl_worker_notify_init() != 0)
+		return -1;
+
+	workers.threads = calloc(thread_num, sizeof(*workers.threads));
+	if (!workers.threads) {
+		DSLMNGR_LOG(LOG_ERR, "Out of memory\n");
+		return -1;
+	}
+
+	for (i = 0; i < thread_num; i++) {
+		if (pthread_create(&workers.threads[i], NULL, dsl_worker_main, NULL) != 0) {
+			DSLMNGR_LOG(LOG_ERR, "Failed to create worker thread %d\n", i);
+			break;
+		}
+		pthread_detach(workers.threads[i]);
+	}
+	workers.thread_num = i;
+
+	return 0;
+}
+
+/**
+ * This function queues a job to be run by a worker thread. Its done() is called afterwards in the
+ * main thread from uloop.
+ *
+ * @return 0 on success, -1 if there is no worker thread in which case the caller must do the work
+ */
+int dsl_worker_submit(struct dsl_job *job)
+{
+	if (workers.thread_num == 0)
+		return -1;
+
+	job->pending = NULL;
+	pthread_mutex_lock(&workers.lock);
+	list_add_tail(&job->list, &workers.queue);
+	pthread_cond_signal(&workers.queued);
+	pthread_mutex_unlock(&workers.lock);
+
+	return 0;
+}
+
+static void *dsl_worker_spawned_main(void *arg)
+{
+	struct dsl_job *job = arg;
+
+	job->run(job);
+	dsl_worker_hand_back(job);
+
+	return NULL;
+}
+
+/**
+ * This function runs a job in a thread of its own, which exits afterwards, so that a long job
+ * neither holds a worker thread up nor requires any. Its done() is called afterwards in the main
+ * thread from uloop.
+ *
+ * @return 0 on success, -1 if the thread could not be created
+ */
+int dsl_worker_spawn(struct dsl_job *job)
+{
+	pthread_t thread;
+
+	if (workers.notify_fd < 0 && dsl_worker_notify_init() != 0)
+		return -1;
+
+	job->pending = NULL;
+	if (pthread_create(&thread, NULL, dsl_worker_spawned_main, job) != 0) {
+		DSLMNGR_LOG(LOG_ERR, "Failed to create a thread\n");
+		return -1;
+	}
+	pthread_detach(thread);
+
+	return 0;
+}
+
+void dsl_worker_run(struct dsl_job **jobs, int num)
+{
+	int pending, i;
+
+	// Nothing to gain from handing a single job over to another thread
+	if (workers.thread_num == 0 || num <= 1) {
+		for (i = 0; i < num; i++)
+			jobs[i]->run(jobs[i]);
+		return;
+	}
+
+	pending = num - 1;
+	pthread_mutex_lock(&workers.lock);
+	for (i = 1; i < num; i++) {
+		jobs[i]->pending = &pending;
+		list_add_tail(&jobs[i]->list, &workers.queue);
+	}
+	pthread_cond_broadcast(&workers.queued);
+	pthread_mutex_unlock(&workers.lock);
+
+	// The caller takes the first job itself instead of idling
+	jobs[0]->run(jobs[0]);
+
+	pthread_mutex_lock(&workers.lock);
+	while (pending > 0)
+		pthread_cond_wait(&workers.finished, &workers.lock);
+	pthread_mutex_unlock(&workers.lock);
+}
@@ -0,0 +1,205 @@
+/*
+ * utils_bench.c - microbenchmark of the string helpers against the code they replaced
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "utils.h"
+
+/**
+ * The list parser and the hex encoder are checked against the strtok_r() + atoi() and sprintf()
+ * code which dsl_get_line_info() used before, on random inputs, then both are timed on inputs as
+ * returned by DSL FAPI. Build it with "make bench" and run "./utils_bench [iterations]".
+ */
+#define CHECK_ROUNDS 200000
+#define LIST_SIZE 24
+
+static const char *snr_mpb = "-512,-512,-512,-512,-512,123,456,789,1023,0,17,-1";
+static const char *allowed_profiles = "8a,8b,8c,8d,12a,12b,17a,30a,35b";
+static const unsigned char vendor[8] = { 0xB5, 0x00, 0x42, 0x44, 0x43, 0x4D, 0xA2, 0x1F };
+
+static volatile long sink;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// The code which was replaced, the list being tokenized in place as DSL FAPI's buffer was
+static int ref_parse_long_list(char *str, long *array, int size)
+{
+	char *token, *saveptr;
+	int count;
+
+	token = strtok_r(str, ",", &saveptr);
+	for (count = 0; count < size && token != NULL; count++, token = strtok_r(NULL, ",", &saveptr))
+		array[count] = atoi(token);
+
+	return count;
+}
+
+static void ref_hex_encode(char *dst, const unsigned char *src, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+		sprintf(dst + i * 2, "%02X", src[i]);
+}
+
+// Items of at most 9 digits, beyond which atoi() is undefined
+static void random_list(char *str, int size)
+{
+	static const char alphabet[] = "0123456789,,,- +x\t";
+	int len = rand() % (size - 1), digits = 0, i;
+	char c;
+
+	for (i = 0; i < len; i++) {
+		c = alphabet[rand() % (sizeof(alphabet) - 1)];
+		digits = c >= '0' && c <= '9' ? digits + 1 : 0;
+		if (digits > 9) {
+			c = ',';
+			digits = 0;
+		}
+		str[i] = c;
+	}
+	str[len] = '\0';
+}
+
+static int check(void)
+{
+	char str[128], copy[128], ref_hex[17], hex[17];
+	long ref[LIST_SIZE], values[LIST_SIZE];
+	unsigned char bytes[8];
+	char *token, *saveptr, *cursor;
+	int round, ref_count, count;
+	size_t i;
+
+	srand(1);
+	for (round = 0; round < CHECK_ROUNDS; round++) {
+		random_list(str, sizeof(str));
+
+		strcpy(copy, str);
+		ref_count = ref_parse_long_list(copy, ref, LIST_SIZE);
+		count = dsl_parse_long_list(str, values, LIST_SIZE);
+		if (count != ref_count || memcmp(values, ref, count * sizeof(values[0])) != 0) {
+			fprintf(stderr, "dsl_parse_long_list() differs on \"%s\"\n", str);
+			return -1;
+		}
+
+		strcpy(copy, str);
+		token = strtok_r(copy, ",", &saveptr);
+		cursor = str;
+		for (;;) {
+			char *item = dsl_list_next(&cursor);
+
+			if ((item == NULL) != (token == NULL) || (item && strcmp(item, token) != 0)) {
+				fprintf(stderr, "dsl_list_next() differs on \"%s\"\n", copy);
+				return -1;
+			}
+			if (item == NULL)
+				break;
+			token = strtok_r(NULL, ",", &saveptr);
+		}
+
+		for (i = 0; i < sizeof(bytes); i++)
+			bytes[i] = (unsigned char)rand();
+		ref_hex_encode(ref_hex, bytes, sizeof(bytes));
+		dsl_hex_encode(hex, sizeof(hex), bytes, sizeof(bytes));
+		if (strcmp(hex, ref_hex) != 0) {
+			fprintf(stderr, "dsl_hex_encode() gives %s instead of %s\n", hex, ref_hex);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void report(const char *name, double ref_time, double new_time, long iterations)
+{
+	printf("%-18s %8.0f ns %8.0f ns %6.1fx\n", name, ref_time / iterations * 1e9,
+			new_time / iterations * 1e9, ref_time / new_time);
+}
+
+int main(int argc, char **argv)
+{
+	long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+	long values[LIST_SIZE], i;
+	char copy[64], hex[17], *cursor, *token, *saveptr;
+	double t0, t1, t2;
+	int count;
+
+	if (iterations <= 0 || check() != 0)
+		return 1;
+	printf("%d random inputs give the same results\n\n", CHECK_ROUNDS);
+	printf("%-18s %11s %11s %7s\n", "", "old", "new", "");
+
+	// Both copy the list since the old code modifies it
+	t0 = now();
+	for (i = 0; i < iterations; i++) {
+		strcpy(copy, snr_mpb);
+		count = ref_parse_long_list(copy, values, LIST_SIZE);
+		sink += values[count - 1];
+	}
+	t1 = now();
+	for (i = 0; i < iterations; i++) {
+		strcpy(copy, snr_mpb);
+		count = dsl_parse_long_list(copy, values, LIST_SIZE);
+		sink += values[count - 1];
+	}
+	t2 = now();
+	report("integer list", t1 - t0, t2 - t1, iterations);
+
+	t0 = now();
+	for (i = 0; i < iterations; i++) {
+		strcpy(copy, allowed_profiles);
+		for (token = strtok_r(copy, ",", &saveptr); token; token = strtok_r(NULL, ",", &saveptr))
+			sink += *token;
+	}
+	t1 = now();
+	for (i = 0; i < iterations; i++) {
+		strcpy(copy, allowed_profiles);
+		cursor = copy;
+		while ((token = dsl_list_next(&cursor)) != NULL)
+			sink += *token;
+	}
+	t2 = now();
+	report("tokens", t1 - t0, t2 - t1, iterations);
+
+	t0 = now();
+	for (i = 0; i < iterations; i++) {
+		ref_hex_encode(hex, vendor, sizeof(vendor));
+		sink += hex[3];
+	}
+	t1 = now();
+	for (i = 0; i < iterations; i++) {
+		dsl_hex_encode(hex, sizeof(hex), vendor, sizeof(vendor));
+		sink += hex[3];
+	}
+	t2 = now();
+	report("hex vendor ID", t1 - t0, t2 - t1, iterations);
+
+	return 0;
+}
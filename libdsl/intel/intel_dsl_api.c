@@ -32,6 +32,7 @@
 #include <net/if.h>
 #include <stdbool.h>
 #include <syslog.h>
+#include <pthread.h>
 
 #define INCLUDE_DSL_CPE_API_VRX // This is needed by drv_dsl_cpe_api.h
 #include "drv_dsl_cpe_api/drv_dsl_cpe_api_ioctl.h"
@@ -40,6 +41,7 @@
 
 #include "xdsl.h"
 #include "utils.h"
+#include "trace.h"
 
 /**
  * Mappings among string values and enum ones
@@ -55,29 +57,159 @@ const struct dsl_ops xdsl_ops = {
 	.get_line_stats_interval = dsl_get_line_stats_interval,
 	.get_channel_info = dsl_get_channel_info,
 	.get_channel_stats = dsl_get_channel_stats,
-	.get_channel_stats_interval = dsl_get_channel_stats_interval
+	.get_channel_stats_interval = dsl_get_channel_stats_interval,
+	.get_stats_all = dsl_get_stats_all,
+	.get_ctx_stats = dsl_get_ctx_stats
 };
 
-// TODO: this needs to be updated when supporting DSL bonding
-static int max_line_num = 1;
-static int max_chan_num = 1;
+/**
+ * Besides the entries of xdsl_ops, each DSL FAPI function is traced on its own so that the cost of
+ * the driver can be told apart from that of the conversions.
+ */
+enum {
+	TRACE_FAPI_OPEN = __DSL_TRACE_OPS_MAX,
+	TRACE_FAPI_LINE_GET,
+	TRACE_FAPI_LINE_STATS_GET,
+	TRACE_FAPI_LINE_STATS_TOTAL_GET,
+	TRACE_FAPI_LINE_STATS_SHOWTIME_GET,
+	TRACE_FAPI_LINE_STATS_LAST_SHOWTIME_GET,
+	TRACE_FAPI_LINE_STATS_CURRENT_DAY_GET,
+	TRACE_FAPI_LINE_STATS_QUARTER_HOUR_GET,
+	TRACE_FAPI_CHANNEL_GET,
+	TRACE_FAPI_CHANNEL_STATS_GET,
+	TRACE_FAPI_CHANNEL_STATS_TOTAL_GET,
+	TRACE_FAPI_CHANNEL_STATS_SHOWTIME_GET,
+	TRACE_FAPI_CHANNEL_STATS_LAST_SHOWTIME_GET,
+	TRACE_FAPI_CHANNEL_STATS_CURRENT_DAY_GET,
+	TRACE_FAPI_CHANNEL_STATS_QUARTER_HOUR_GET,
+	__TRACE_MAX
+};
+
+struct dsl_trace_point dsl_trace_points[__TRACE_MAX] = {
+	DSL_TRACE_OPS_POINTS,
+	DSL_TRACE_POINT(TRACE_FAPI_OPEN, "fapi_dsl_open", "dev=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_LINE_GET, "fapi_dsl_line_get", "line=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_LINE_STATS_GET, "fapi_dsl_line_stats_get", "line=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_LINE_STATS_TOTAL_GET, "fapi_dsl_line_stats_total_get", "line=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_LINE_STATS_SHOWTIME_GET, "fapi_dsl_line_stats_showtime_get", "line=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_LINE_STATS_LAST_SHOWTIME_GET, "fapi_dsl_line_stats_last_showtime_get", "line=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_LINE_STATS_CURRENT_DAY_GET, "fapi_dsl_line_stats_current_day_get", "line=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_LINE_STATS_QUARTER_HOUR_GET, "fapi_dsl_line_stats_quarter_hour_get", "line=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_CHANNEL_GET, "fapi_dsl_channel_get", "channel=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_CHANNEL_STATS_GET, "fapi_dsl_channel_stats_get", "channel=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_CHANNEL_STATS_TOTAL_GET, "fapi_dsl_channel_stats_total_get", "channel=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_CHANNEL_STATS_SHOWTIME_GET, "fapi_dsl_channel_stats_showtime_get", "channel=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_CHANNEL_STATS_LAST_SHOWTIME_GET, "fapi_dsl_channel_stats_last_showtime_get", "channel=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_CHANNEL_STATS_CURRENT_DAY_GET, "fapi_dsl_channel_stats_current_day_get", "channel=%d"),
+	DSL_TRACE_POINT(TRACE_FAPI_CHANNEL_STATS_QUARTER_HOUR_GET, "fapi_dsl_channel_stats_quarter_hour_get", "channel=%d"),
+};
+
+const int dsl_trace_point_num = __TRACE_MAX;
+
+/* Calls a DSL FAPI function returning its status with the tracing of the trace point id */
+#define TRACE_FAPI(id, dev_num, call) ({ \
+				uint64_t __start = dsl_trace_begin(); \
+				enum fapi_dsl_status __status = (call); \
+				dsl_trace_end(&dsl_trace_points[id], __start, \
+					__status != FAPI_DSL_STATUS_SUCCESS, dev_num, 0, 0); \
+				__status; \
+			})
+
+/* Opens a DSL FAPI context with the tracing of fapi_dsl_open() */
+static struct fapi_dsl_ctx *fapi_ctx_open(int dev_num)
+{
+	uint64_t start = dsl_trace_begin();
+	struct fapi_dsl_ctx *ctx = fapi_dsl_open(dev_num);
+
+	dsl_trace_end(&dsl_trace_points[TRACE_FAPI_OPEN], start, ctx == NULL, dev_num, 0, 0);
+	return ctx;
+}
+
+/* Discovered at runtime by dsl_probe_lines() */
+static int max_line_num;
+static int max_chan_num;
+static pthread_once_t probe_once = PTHREAD_ONCE_INIT;
+
+static void dsl_probe_lines(void);
 
 int dsl_get_line_number(void)
 {
-	return max_line_num;
+	pthread_once(&probe_once, dsl_probe_lines);
+
+	return max_line_num > 0 ? max_line_num : -1;
 }
 
 int dsl_get_channel_number(void)
 {
-	return max_chan_num;
+	pthread_once(&probe_once, dsl_probe_lines);
+
+	return max_chan_num > 0 ? max_chan_num : -1;
+}
+
+/**
+ * The string to enum conversions are done by a perfect hash built once for each mapping array
+ * instead of scanning the array. Each mapping array is small enough that a seed without any
+ * collision is always found for a table of STR_ENUM_SLOTS slots, in which case a lookup costs one
+ * hash and one strcasecmp(). Otherwise the array is scanned as before.
+ */
+#define STR_ENUM_SLOTS 32
+#define STR_ENUM_MAX_SEEDS 4096
+
+struct str_enum_index {
+	const struct str_enum_map *mappings;
+	uint32_t seed;
+	bool perfect;
+	signed char slots[STR_ENUM_SLOTS];
+};
+
+static pthread_once_t enum_index_once = PTHREAD_ONCE_INIT;
+
+static void dsl_build_enum_indices(void);
+
+// Case insensitive FNV-1a
+static uint32_t str_enum_hash(const char *str, uint32_t seed)
+{
+	uint32_t hash = 2166136261u ^ seed;
+
+	for (; *str != '\0'; str++) {
+		hash ^= (uint32_t)tolower((unsigned char)*str);
+		hash *= 16777619u;
+	}
+
+	return hash % STR_ENUM_SLOTS;
+}
+
+static void dsl_build_enum_index(struct str_enum_index *index)
+{
+	const struct str_enum_map *element;
+	uint32_t seed, slot;
+
+	for (seed = 0; seed < STR_ENUM_MAX_SEEDS; seed++) {
+		memset(index->slots, -1, sizeof(index->slots));
+		for (element = index->mappings; element->val_str != NULL; element++) {
+			slot = str_enum_hash(element->val_str, seed);
+			if (index->slots[slot] >= 0)
+				break;
+			index->slots[slot] = (signed char)(element - index->mappings);
+		}
+
+		if (element->val_str == NULL) {
+			index->seed = seed;
+			index->perfect = true;
+			return;
+		}
+	}
+
+	LIBDSL_LOG(LOG_WARNING, "no perfect hash for the mappings of \"%s\"\n", index->mappings->val_str);
+	index->perfect = false;
 }
 
 /**
 	This function converts a string value to the corresponding enum value.
 
-	\param mappings
-		The mapping arrays whose element contains a string value and an enum one.
-		This parameter must end with { NULL, -1 }.
+	\param index
+		The index of the mapping array whose element contains a string value and an enum one.
+		The mapping array must end with { NULL, -1 }.
 
 	\param str_value
 		The string value to be searched.
@@ -85,11 +217,22 @@ int dsl_get_channel_number(void)
 	\return
 		Returns 0 on success. Otherwise a negative value is returned.
 */
-static int dsl_get_enum_value(const struct str_enum_map *mappings, const char *str_value)
+static int dsl_get_enum_value(const struct str_enum_index *index, const char *str_value)
 {
 	const struct str_enum_map *element;
+	int i;
+
+	pthread_once(&enum_index_once, dsl_build_enum_indices);
+
+	if (index->perfect) {
+		i = index->slots[str_enum_hash(str_value, index->seed)];
+		if (i >= 0 && strcasecmp(index->mappings[i].val_str, str_value) == 0)
+			return index->mappings[i].val_enum;
 
-	for (element = mappings; element->val_str != NULL; element++) {
+		return -1;
+	}
+
+	for (element = index->mappings; element->val_str != NULL; element++) {
 		if (strcasecmp(element->val_str, str_value) == 0)
 			return element->val_enum;
 	}
@@ -97,16 +240,181 @@ static int dsl_get_enum_value(const struct str_enum_map *mappings, const char *s
 	return -1;
 }
 
+/**
+ * The DSL FAPI contexts are kept open in a small pool per device and shared among all callers
+ * instead of being opened and closed around every single call. Each line is a separate device
+ * so that lines can be accessed in parallel.
+ */
+#define FAPI_CTX_POOL_SIZE 4
+
+struct fapi_ctx_slot {
+	struct fapi_dsl_ctx *ctx;
+	bool in_use;
+};
+
+struct fapi_ctx_pool {
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int dev_num;
+	struct fapi_ctx_slot slots[FAPI_CTX_POOL_SIZE];
+	struct dsl_ctx_stats stats;
+};
+
+static struct fapi_ctx_pool ctx_pools[XDSL_MAX_LINES];
+
+/**
+	This function discovers the DSL lines by opening the devices one after another until it fails.
+	The context opened for each line is kept in the line's pool for later use.
+*/
+static void dsl_probe_lines(void)
+{
+	struct fapi_dsl_ctx *ctx;
+	int i;
+
+	for (i = 0; i < XDSL_MAX_LINES; i++) {
+		pthread_mutex_init(&ctx_pools[i].lock, NULL);
+		pthread_cond_init(&ctx_pools[i].cond, NULL);
+		ctx_pools[i].dev_num = i;
+	}
+
+	for (i = 0; i < XDSL_MAX_LINES; i++) {
+		ctx = fapi_ctx_open(i);
+		if (!ctx)
+			break;
+		ctx_pools[i].slots[0].ctx = ctx;
+		ctx_pools[i].stats.opens++;
+	}
+
+	// Only one bearer channel per line is supported
+	max_line_num = i;
+	max_chan_num = i;
+
+	if (max_line_num == 0)
+		LIBDSL_LOG(LOG_ERR, "No DSL line found\n");
+}
+
+/**
+	This function takes a DSL FAPI context from the pool of a device. An idle open context is
+	preferred. Otherwise a free slot is opened. The caller is blocked if all contexts are in use.
+
+	\param dev_num
+		The device, i.e. line, number.
+
+	\return
+		Returns the slot holding an open context on success. Otherwise NULL is returned.
+*/
+static struct fapi_ctx_slot *fapi_ctx_acquire(int dev_num)
+{
+	struct fapi_ctx_pool *pool = &ctx_pools[dev_num];
+	struct fapi_ctx_slot *slot, *free_slot;
+	struct fapi_dsl_ctx *ctx;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		free_slot = NULL;
+		for (slot = pool->slots; slot < pool->slots + FAPI_CTX_POOL_SIZE; slot++) {
+			if (slot->in_use)
+				continue;
+			if (slot->ctx) {
+				slot->in_use = true;
+				pool->stats.reuses++;
+				pthread_mutex_unlock(&pool->lock);
+				return slot;
+			}
+			if (!free_slot)
+				free_slot = slot;
+		}
+		if (free_slot)
+			break;
+		pthread_cond_wait(&pool->cond, &pool->lock);
+	}
+
+	// Reserve the slot and open the context without holding the lock
+	free_slot->in_use = true;
+	pthread_mutex_unlock(&pool->lock);
+
+	ctx = fapi_ctx_open(dev_num);
+
+	pthread_mutex_lock(&pool->lock);
+	if (ctx) {
+		free_slot->ctx = ctx;
+		pool->stats.opens++;
+	} else {
+		free_slot->in_use = false;
+		pool->stats.open_errors++;
+		pthread_cond_signal(&pool->cond);
+		free_slot = NULL;
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	if (!ctx)
+		LIBDSL_LOG(LOG_ERR, "fapi_dsl_open(%d) failed\n", dev_num);
+
+	return free_slot;
+}
+
+/**
+	This function returns a DSL FAPI context to the pool.
+
+	\param dev_num
+		The device number passed to fapi_ctx_acquire().
+
+	\param slot
+		The slot returned by fapi_ctx_acquire().
+
+	\param failed
+		Whether a DSL FAPI call on the context has failed. The context is closed in this case and
+		will be reopened on next use.
+*/
+static void fapi_ctx_release(int dev_num, struct fapi_ctx_slot *slot, bool failed)
+{
+	struct fapi_ctx_pool *pool = &ctx_pools[dev_num];
+	struct fapi_dsl_ctx *ctx = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	if (failed) {
+		ctx = slot->ctx;
+		slot->ctx = NULL;
+		pool->stats.drops++;
+	}
+	slot->in_use = false;
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	if (ctx)
+		fapi_dsl_close(ctx);
+}
+
+int dsl_get_ctx_stats(struct dsl_ctx_stats *stats)
+{
+	struct fapi_ctx_pool *pool;
+	int i, max_line = dsl_get_line_number();
+
+	memset(stats, 0, sizeof(*stats));
+	for (i = 0; i < max_line; i++) {
+		pool = &ctx_pools[i];
+		pthread_mutex_lock(&pool->lock);
+		stats->opens += pool->stats.opens;
+		stats->reuses += pool->stats.reuses;
+		stats->open_errors += pool->stats.open_errors;
+		stats->drops += pool->stats.drops;
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return 0;
+}
+
 #define OPEN_DSL_FAPI_CTX(dev_num) do { \
-				if (dev_num < 0 || dev_num >= max_line_num) \
+				if (dev_num < 0 || dev_num >= dsl_get_line_number()) \
 					return -1; \
-				fapi_ctx = fapi_dsl_open(0); \
-				if (!fapi_ctx) { \
-					LIBDSL_LOG(LOG_ERR, "fapi_dsl_open() failed\n"); \
+				ctx_slot = fapi_ctx_acquire(dev_num); \
+				if (!ctx_slot) \
 					return -1; \
-				} \
+				fapi_ctx = ctx_slot->ctx; \
 			} while (0)
 
+#define CLOSE_DSL_FAPI_CTX(dev_num) fapi_ctx_release(dev_num, ctx_slot, retval != 0)
+
 static const struct str_enum_map if_status[] = {
 	{ "Up", IF_UP },
 	{ "Down", IF_DOWN },
@@ -118,9 +426,11 @@ static const struct str_enum_map if_status[] = {
 	{ NULL, -1 }
 };
 
+static struct str_enum_index if_status_index = { .mappings = if_status };
+
 static enum dsl_if_status ifstatus_str2enum(const char *status_str)
 {
-	int status = dsl_get_enum_value(if_status, status_str);
+	int status = dsl_get_enum_value(&if_status_index, status_str);
 
 	if (status >= 0)
 		return (enum dsl_if_status)status;
@@ -138,9 +448,11 @@ static const struct str_enum_map link_status[] = {
 	{ NULL, -1 }
 };
 
+static struct str_enum_index link_status_index = { .mappings = link_status };
+
 static enum dsl_link_status linkstatus_str2enum(const char *status_str)
 {
-	int status = dsl_get_enum_value(link_status, status_str);
+	int status = dsl_get_enum_value(&link_status_index, status_str);
 
 	if (status >= 0)
 		return (enum dsl_link_status)status;
@@ -161,9 +473,11 @@ static const struct str_enum_map profiles[] = {
 	{ NULL, -1 }
 };
 
+static struct str_enum_index profiles_index = { .mappings = profiles };
+
 static enum dsl_profile profile_str2enum(const char *prof_str)
 {
-	int profile = dsl_get_enum_value(profiles, prof_str);
+	int profile = dsl_get_enum_value(&profiles_index, prof_str);
 
 	if (profile >= 0)
 		return (enum dsl_profile)profile;
@@ -180,9 +494,11 @@ static const struct str_enum_map power_states[] = {
 	{ NULL, -1 }
 };
 
+static struct str_enum_index power_states_index = { .mappings = power_states };
+
 static enum dsl_power_state powerstate_str2enum(const char *power_state)
 {
-	int state = dsl_get_enum_value(power_states, power_state);
+	int state = dsl_get_enum_value(&power_states_index, power_state);
 
 	if (state >= 0)
 		return (enum dsl_power_state)state;
@@ -190,20 +506,20 @@ static enum dsl_power_state powerstate_str2enum(const char *power_state)
 	return (enum dsl_power_state)0;
 }
 
-int dsl_get_line_info(int line_num, struct dsl_line *line)
+static int intel_get_line_info(int line_num, struct dsl_line *line)
 {
 	int retval = 0;
+	struct fapi_ctx_slot *ctx_slot;
 	struct fapi_dsl_ctx *fapi_ctx;
 	struct dsl_fapi_line_obj obj;
-	char *token, *saveptr;
-	int num, i;
+	char *token, *cursor;
 
 	// Open the DSL FAPI context
 	OPEN_DSL_FAPI_CTX(line_num);
 
 	// Get the data
 	memset(&obj, 0, sizeof(obj));
-	if (fapi_dsl_line_get(fapi_ctx, &obj) != FAPI_DSL_STATUS_SUCCESS) {
+	if (TRACE_FAPI(TRACE_FAPI_LINE_GET, line_num, fapi_dsl_line_get(fapi_ctx, &obj)) != FAPI_DSL_STATUS_SUCCESS) {
 		LIBDSL_LOG(LOG_ERR, "fapi_dsl_line_get() failed\n");
 		retval = -1;
 		goto __ret;
@@ -230,32 +546,21 @@ int dsl_get_line_info(int line_num, struct dsl_line *line)
 	line->line_encoding = LE_DMT;
 
 	// Allowed profiles and the currently used profile
-	token = strtok_r(obj.allowed_profiles, ",", &saveptr);
-	while (token != NULL) {
+	cursor = obj.allowed_profiles;
+	while ((token = dsl_list_next(&cursor)) != NULL)
 		line->allowed_profiles |= profile_str2enum(token);
-		// Move to the next token
-		token = strtok_r(NULL, ",", &saveptr);
-	}
 	line->current_profile = profile_str2enum(obj.current_profile);
 
 	line->power_management_state = powerstate_str2enum(obj.power_management_state);
 	line->success_failure_cause = obj.success_failure_cause;
 
 	// upbokler_pb
-	token = strtok_r(obj.upbokler_pb, ",", &saveptr);
-	for (num = sizeof (line->upbokler_pb.array) / sizeof (line->upbokler_pb.array[0]);
-		 line->upbokler_pb.count < num && token != NULL;
-		 line->upbokler_pb.count++, token = strtok_r(NULL, ",", &saveptr)) {
-		line->upbokler_pb.array[line->upbokler_pb.count] = atoi(token);
-	}
+	line->upbokler_pb.count = dsl_parse_ulong_list(obj.upbokler_pb, line->upbokler_pb.array,
+			sizeof(line->upbokler_pb.array) / sizeof(line->upbokler_pb.array[0]));
 
 	// rxthrsh_ds
-	token = strtok_r(obj.rxthrsh_ds, ",", &saveptr);
-	for (num = sizeof (line->rxthrsh_ds.array) / sizeof (line->rxthrsh_ds.array[0]);
-		 line->rxthrsh_ds.count < num && token != NULL;
-		 line->rxthrsh_ds.count++, token = strtok_r(NULL, ",", &saveptr)) {
-		line->rxthrsh_ds.array[line->rxthrsh_ds.count] = atoi(token);
-	}
+	line->rxthrsh_ds.count = dsl_parse_ulong_list(obj.rxthrsh_ds, line->rxthrsh_ds.array,
+			sizeof(line->rxthrsh_ds.array) / sizeof(line->rxthrsh_ds.array[0]));
 
 	line->act_ra_mode.us = obj.act_ra_mode_us;
 	line->act_ra_mode.ds = obj.act_ra_mode_ds;
@@ -283,20 +588,12 @@ int dsl_get_line_info(int line_num, struct dsl_line *line)
 	line->noise_margin.ds = obj.downstream_noise_margin;
 
 	// snr_mpb_us
-	token = strtok_r(obj.snr_mpb_us, ",", &saveptr);
-	for (num = sizeof (line->snr_mpb_us.array) / sizeof (line->snr_mpb_us.array[0]);
-		 line->snr_mpb_us.count < num && token != NULL;
-		 line->snr_mpb_us.count++, token = strtok_r(NULL, ",", &saveptr)) {
-		line->snr_mpb_us.array[line->snr_mpb_us.count] = atoi(token);
-	}
+	line->snr_mpb_us.count = dsl_parse_long_list(obj.snr_mpb_us, line->snr_mpb_us.array,
+			sizeof(line->snr_mpb_us.array) / sizeof(line->snr_mpb_us.array[0]));
 
 	// snr_mpb_ds
-	token = strtok_r(obj.snr_mpb_ds, ",", &saveptr);
-	for (num = sizeof (line->snr_mpb_ds.array) / sizeof (line->snr_mpb_ds.array[0]);
-		 line->snr_mpb_ds.count < num && token != NULL;
-		 line->snr_mpb_ds.count++, token = strtok_r(NULL, ",", &saveptr)) {
-		line->snr_mpb_ds.array[line->snr_mpb_ds.count] = atoi(token);
-	}
+	line->snr_mpb_ds.count = dsl_parse_long_list(obj.snr_mpb_ds, line->snr_mpb_ds.array,
+			sizeof(line->snr_mpb_ds.array) / sizeof(line->snr_mpb_ds.array[0]));
 
 	line->attenuation.us = obj.upstream_attenuation;
 	line->attenuation.ds = obj.downstream_attenuation;
@@ -305,53 +602,40 @@ int dsl_get_line_info(int line_num, struct dsl_line *line)
 	line->power.ds = obj.downstream_power;
 
 	// XTU-R vendor ID
-	num = (sizeof(line->xtur_vendor) / 2) < sizeof(obj.xtur_vendor) ?
-			(sizeof(line->xtur_vendor) / 2) : sizeof(obj.xtur_vendor);
-	for (i = 0; i < num; i++)
-		sprintf(line->xtur_vendor + i * 2, "%02X", obj.xtur_vendor[i]);
+	dsl_hex_encode(line->xtur_vendor, sizeof(line->xtur_vendor),
+			obj.xtur_vendor, sizeof(obj.xtur_vendor));
 
 	// XTU-R country
-	num = (sizeof(line->xtur_country) / 2) < sizeof(obj.xtur_country) ?
-			(sizeof(line->xtur_country) / 2) : sizeof(obj.xtur_country);
-	for (i = 0; i < num; i++)
-		sprintf(line->xtur_country + i * 2, "%02X", obj.xtur_country[i]);
+	dsl_hex_encode(line->xtur_country, sizeof(line->xtur_country),
+			obj.xtur_country, sizeof(obj.xtur_country));
 
 	line->xtur_ansi_std = obj.xtur_ansi_std;
 	line->xtur_ansi_rev = obj.xtur_ansi_rev;
 
 	// XTU-C vendor ID
-	num = (sizeof(line->xtuc_vendor) / 2) < (sizeof(obj.xtuc_vendor) / sizeof(obj.xtuc_vendor[0]))?
-			(sizeof(line->xtuc_vendor) / 2) : (sizeof(obj.xtuc_vendor) / sizeof(obj.xtuc_vendor[0]));
-	for (i = 0; i < num; i++)
-		sprintf(line->xtuc_vendor + i * 2, "%02X", obj.xtuc_vendor[i]);
+	dsl_hex_encode(line->xtuc_vendor, sizeof(line->xtuc_vendor),
+			obj.xtuc_vendor, sizeof(obj.xtuc_vendor));
 
 	// XTU-C country
-	num = (sizeof(line->xtuc_country) / 2) < sizeof(obj.xtuc_country) ?
-			(sizeof(line->xtuc_country) / 2) : (sizeof(obj.xtuc_country) / sizeof(obj.xtuc_country[0]));
-	for (i = 0; i < num; i++)
-		sprintf(line->xtuc_country + i * 2, "%02X", obj.xtuc_country[i]);
+	dsl_hex_encode(line->xtuc_country, sizeof(line->xtuc_country),
+			obj.xtuc_country, sizeof(obj.xtuc_country));
 
 	line->xtuc_ansi_std = obj.xtuc_ansi_std;
 	line->xtuc_ansi_rev = obj.xtuc_ansi_rev;
 
 __ret:
-	if (fapi_ctx)
-		fapi_dsl_close(fapi_ctx);
+	CLOSE_DSL_FAPI_CTX(line_num);
 	return retval;
 }
 
-int dsl_get_line_stats(int line_num, struct dsl_line_channel_stats *stats)
+static int fapi_get_line_stats(struct fapi_dsl_ctx *fapi_ctx, int dev_num, struct dsl_line_channel_stats *stats)
 {
 	int retval = 0;
-	struct fapi_dsl_ctx *fapi_ctx;
 	struct dsl_fapi_line_stats_obj obj;
 
-	// Open the DSL FAPI context
-	OPEN_DSL_FAPI_CTX(line_num);
-
 	// Get the data
 	memset(&obj, 0, sizeof(obj));
-	if (fapi_dsl_line_stats_get(fapi_ctx, &obj) != FAPI_DSL_STATUS_SUCCESS) {
+	if (TRACE_FAPI(TRACE_FAPI_LINE_STATS_GET, dev_num, fapi_dsl_line_stats_get(fapi_ctx, &obj)) != FAPI_DSL_STATUS_SUCCESS) {
 		LIBDSL_LOG(LOG_ERR, "fapi_dsl_line_stats_get() failed\n");
 		retval = -1;
 		goto __ret;
@@ -368,38 +652,47 @@ int dsl_get_line_stats(int line_num, struct dsl_line_channel_stats *stats)
 	stats->quarter_hour_start = obj.quarter_hour_start;
 
 __ret:
-	if (fapi_ctx)
-		fapi_dsl_close(fapi_ctx);
 	return retval;
 }
 
-int dsl_get_line_stats_interval(int line_num, enum dsl_stats_type type, struct dsl_line_stats_interval *stats)
+static int intel_get_line_stats(int line_num, struct dsl_line_channel_stats *stats)
 {
-	int retval = 0;
+	int retval;
+	struct fapi_ctx_slot *ctx_slot;
 	struct fapi_dsl_ctx *fapi_ctx;
-	struct dsl_fapi_line_stats_interval_obj obj;
-	enum fapi_dsl_status status;
 
 	// Open the DSL FAPI context
 	OPEN_DSL_FAPI_CTX(line_num);
 
+	retval = fapi_get_line_stats(fapi_ctx, line_num, stats);
+
+	CLOSE_DSL_FAPI_CTX(line_num);
+	return retval;
+}
+
+static int fapi_get_line_stats_interval(struct fapi_dsl_ctx *fapi_ctx, int dev_num, enum dsl_stats_type type, struct dsl_line_stats_interval *stats)
+{
+	int retval = 0;
+	struct dsl_fapi_line_stats_interval_obj obj;
+	enum fapi_dsl_status status;
+
 	// Get the data
 	memset(&obj, 0, sizeof(obj));
 	switch (type) {
 	case DSL_STATS_TOTAL:
-		status = fapi_dsl_line_stats_total_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_LINE_STATS_TOTAL_GET, dev_num, fapi_dsl_line_stats_total_get(fapi_ctx, &obj));
 		break;
 	case DSL_STATS_SHOWTIME:
-		status = fapi_dsl_line_stats_showtime_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_LINE_STATS_SHOWTIME_GET, dev_num, fapi_dsl_line_stats_showtime_get(fapi_ctx, &obj));
 		break;
 	case DSL_STATS_LASTSHOWTIME:
-		status = fapi_dsl_line_stats_last_showtime_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_LINE_STATS_LAST_SHOWTIME_GET, dev_num, fapi_dsl_line_stats_last_showtime_get(fapi_ctx, &obj));
 		break;
 	case DSL_STATS_CURRENTDAY:
-		status = fapi_dsl_line_stats_current_day_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_LINE_STATS_CURRENT_DAY_GET, dev_num, fapi_dsl_line_stats_current_day_get(fapi_ctx, &obj));
 		break;
 	case DSL_STATS_QUARTERHOUR:
-		status = fapi_dsl_line_stats_quarter_hour_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_LINE_STATS_QUARTER_HOUR_GET, dev_num, fapi_dsl_line_stats_quarter_hour_get(fapi_ctx, &obj));
 		break;
 	default:
 		LIBDSL_LOG(LOG_ERR, "Unknown interval type for DSL line statistics, %d\n", type);
@@ -422,8 +715,21 @@ int dsl_get_line_stats_interval(int line_num, enum dsl_stats_type type, struct d
 	stats->severely_errored_secs = obj.severely_errored_secs;
 
 __ret:
-	if (fapi_ctx)
-		fapi_dsl_close(fapi_ctx);
+	return retval;
+}
+
+static int intel_get_line_stats_interval(int line_num, enum dsl_stats_type type, struct dsl_line_stats_interval *stats)
+{
+	int retval;
+	struct fapi_ctx_slot *ctx_slot;
+	struct fapi_dsl_ctx *fapi_ctx;
+
+	// Open the DSL FAPI context
+	OPEN_DSL_FAPI_CTX(line_num);
+
+	retval = fapi_get_line_stats_interval(fapi_ctx, line_num, type, stats);
+
+	CLOSE_DSL_FAPI_CTX(line_num);
 	return retval;
 }
 
@@ -436,9 +742,11 @@ static const struct str_enum_map link_encaps[] = {
 	{ NULL, -1 }
 };
 
+static struct str_enum_index link_encaps_index = { .mappings = link_encaps };
+
 static enum dsl_link_encapsulation linkencap_str2enum(const char *link_encap)
 {
-	int encap = dsl_get_enum_value(link_encaps, link_encap);
+	int encap = dsl_get_enum_value(&link_encaps_index, link_encap);
 
 	if (encap >= 0)
 		return (enum dsl_link_encapsulation)encap;
@@ -446,19 +754,29 @@ static enum dsl_link_encapsulation linkencap_str2enum(const char *link_encap)
 	return (enum dsl_link_encapsulation)0;
 }
 
-int dsl_get_channel_info(int chan_num, struct dsl_channel *channel)
+static void dsl_build_enum_indices(void)
+{
+	dsl_build_enum_index(&if_status_index);
+	dsl_build_enum_index(&link_status_index);
+	dsl_build_enum_index(&profiles_index);
+	dsl_build_enum_index(&power_states_index);
+	dsl_build_enum_index(&link_encaps_index);
+}
+
+static int intel_get_channel_info(int chan_num, struct dsl_channel *channel)
 {
 	int retval = 0;
+	struct fapi_ctx_slot *ctx_slot;
 	struct fapi_dsl_ctx *fapi_ctx;
 	struct dsl_fapi_channel_obj obj;
-	char *token, *saveptr;
+	char *token, *cursor;
 
 	// Open the DSL FAPI context
 	OPEN_DSL_FAPI_CTX(chan_num);
 
 	// Get the data
 	memset(&obj, 0, sizeof(obj));
-	if (fapi_dsl_channel_get(fapi_ctx, &obj) != FAPI_DSL_STATUS_SUCCESS) {
+	if (TRACE_FAPI(TRACE_FAPI_CHANNEL_GET, chan_num, fapi_dsl_channel_get(fapi_ctx, &obj)) != FAPI_DSL_STATUS_SUCCESS) {
 		LIBDSL_LOG(LOG_ERR, "fapi_dsl_channel_get() failed\n");
 		retval = -1;
 		goto __ret;
@@ -473,12 +791,9 @@ int dsl_get_channel_info(int chan_num, struct dsl_channel *channel)
 	channel->status = ifstatus_str2enum(obj.status);
 
 	// link_encapsulation_supported and link_encapsulation_used
-	token = strtok_r(obj.link_encapsulation_supported, ",", &saveptr);
-	while (token != NULL) {
-		channel->link_encapsulation_supported |= linkencap_str2enum(token);;
-		// Move to the next token
-		token = strtok_r(NULL, ",", &saveptr);
-	}
+	cursor = obj.link_encapsulation_supported;
+	while ((token = dsl_list_next(&cursor)) != NULL)
+		channel->link_encapsulation_supported |= linkencap_str2enum(token);
 	channel->link_encapsulation_used = linkencap_str2enum(obj.link_encapsulation_used);
 
 	channel->lpath = obj.lpath;
@@ -501,23 +816,18 @@ int dsl_get_channel_info(int chan_num, struct dsl_channel *channel)
 	channel->actinprein.ds = obj.actinprein_ds;
 
 __ret:
-	if (fapi_ctx)
-		fapi_dsl_close(fapi_ctx);
+	CLOSE_DSL_FAPI_CTX(chan_num);
 	return retval;
 }
 
-int dsl_get_channel_stats(int chan_num, struct dsl_line_channel_stats *stats)
+static int fapi_get_channel_stats(struct fapi_dsl_ctx *fapi_ctx, int dev_num, struct dsl_line_channel_stats *stats)
 {
 	int retval = 0;
-	struct fapi_dsl_ctx *fapi_ctx;
 	struct dsl_fapi_channel_stats_obj obj;
 
-	// Open the DSL FAPI context
-	OPEN_DSL_FAPI_CTX(chan_num);
-
 	// Get the data
 	memset(&obj, 0, sizeof(obj));
-	if (fapi_dsl_channel_stats_get(fapi_ctx, &obj) != FAPI_DSL_STATUS_SUCCESS) {
+	if (TRACE_FAPI(TRACE_FAPI_CHANNEL_STATS_GET, dev_num, fapi_dsl_channel_stats_get(fapi_ctx, &obj)) != FAPI_DSL_STATUS_SUCCESS) {
 		LIBDSL_LOG(LOG_ERR, "fapi_dsl_channel_stats_get() failed\n");
 		retval = -1;
 		goto __ret;
@@ -534,38 +844,47 @@ int dsl_get_channel_stats(int chan_num, struct dsl_line_channel_stats *stats)
 	stats->quarter_hour_start = obj.quarter_hour_start;
 
 __ret:
-	if (fapi_ctx)
-		fapi_dsl_close(fapi_ctx);
 	return retval;
 }
 
-int dsl_get_channel_stats_interval(int chan_num, enum dsl_stats_type type, struct dsl_channel_stats_interval *stats)
+static int intel_get_channel_stats(int chan_num, struct dsl_line_channel_stats *stats)
 {
-	int retval = 0;
+	int retval;
+	struct fapi_ctx_slot *ctx_slot;
 	struct fapi_dsl_ctx *fapi_ctx;
-	struct dsl_fapi_channel_stats_interval_obj obj;
-	enum fapi_dsl_status status;
 
 	// Open the DSL FAPI context
 	OPEN_DSL_FAPI_CTX(chan_num);
 
+	retval = fapi_get_channel_stats(fapi_ctx, chan_num, stats);
+
+	CLOSE_DSL_FAPI_CTX(chan_num);
+	return retval;
+}
+
+static int fapi_get_channel_stats_interval(struct fapi_dsl_ctx *fapi_ctx, int dev_num, enum dsl_stats_type type, struct dsl_channel_stats_interval *stats)
+{
+	int retval = 0;
+	struct dsl_fapi_channel_stats_interval_obj obj;
+	enum fapi_dsl_status status;
+
 	// Get the data
 	memset(&obj, 0, sizeof(obj));
 	switch (type) {
 	case DSL_STATS_TOTAL:
-		status = fapi_dsl_channel_stats_total_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_CHANNEL_STATS_TOTAL_GET, dev_num, fapi_dsl_channel_stats_total_get(fapi_ctx, &obj));
 		break;
 	case DSL_STATS_SHOWTIME:
-		status = fapi_dsl_channel_stats_showtime_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_CHANNEL_STATS_SHOWTIME_GET, dev_num, fapi_dsl_channel_stats_showtime_get(fapi_ctx, &obj));
 		break;
 	case DSL_STATS_LASTSHOWTIME:
-		status = fapi_dsl_channel_stats_last_showtime_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_CHANNEL_STATS_LAST_SHOWTIME_GET, dev_num, fapi_dsl_channel_stats_last_showtime_get(fapi_ctx, &obj));
 		break;
 	case DSL_STATS_CURRENTDAY:
-		status = fapi_dsl_channel_stats_current_day_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_CHANNEL_STATS_CURRENT_DAY_GET, dev_num, fapi_dsl_channel_stats_current_day_get(fapi_ctx, &obj));
 		break;
 	case DSL_STATS_QUARTERHOUR:
-		status = fapi_dsl_channel_stats_quarter_hour_get(fapi_ctx, &obj);
+		status = TRACE_FAPI(TRACE_FAPI_CHANNEL_STATS_QUARTER_HOUR_GET, dev_num, fapi_dsl_channel_stats_quarter_hour_get(fapi_ctx, &obj));
 		break;
 	default:
 		LIBDSL_LOG(LOG_ERR, "Unknown interval type for DSL channel statistics, %d\n", type);
@@ -594,7 +913,118 @@ int dsl_get_channel_stats_interval(int chan_num, enum dsl_stats_type type, struc
 	stats->xtuc_crc_errors = obj.xtu_ccrc_errors;
 
 __ret:
-	if (fapi_ctx)
-		fapi_dsl_close(fapi_ctx);
+	return retval;
+}
+
+static int intel_get_channel_stats_interval(int chan_num, enum dsl_stats_type type, struct dsl_channel_stats_interval *stats)
+{
+	int retval;
+	struct fapi_ctx_slot *ctx_slot;
+	struct fapi_dsl_ctx *fapi_ctx;
+
+	// Open the DSL FAPI context
+	OPEN_DSL_FAPI_CTX(chan_num);
+
+	retval = fapi_get_channel_stats_interval(fapi_ctx, chan_num, type, stats);
+
+	CLOSE_DSL_FAPI_CTX(chan_num);
+	return retval;
+}
+
+static int intel_get_stats_all(int line_num, struct dsl_stats_all *stats)
+{
+	int retval = 0;
+	struct fapi_ctx_slot *ctx_slot;
+	struct fapi_dsl_ctx *fapi_ctx;
+	int i;
+
+	// Open the DSL FAPI context
+	OPEN_DSL_FAPI_CTX(line_num);
+
+	// Retrieve all counters back to back on the same context
+	if (fapi_get_line_stats(fapi_ctx, line_num, &stats->line) != 0 ||
+		fapi_get_channel_stats(fapi_ctx, line_num, &stats->channel) != 0) {
+		retval = -1;
+		goto __ret;
+	}
+
+	for (i = 0; i < DSL_STATS_INTERVAL_NUM; i++) {
+		if (fapi_get_line_stats_interval(fapi_ctx, line_num, DSL_STATS_TOTAL + i, &stats->line_intervals[i]) != 0 ||
+			fapi_get_channel_stats_interval(fapi_ctx, line_num, DSL_STATS_TOTAL + i,
+				&stats->channel_intervals[i]) != 0) {
+			retval = -1;
+			goto __ret;
+		}
+	}
+
+__ret:
+	CLOSE_DSL_FAPI_CTX(line_num);
+	return retval;
+}
+
+/**
+ * The entries of xdsl_ops are traced as a whole, i.e. including the wait for a DSL FAPI context and
+ * the conversions of the data.
+ */
+int dsl_get_line_info(int line_num, struct dsl_line *line)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = intel_get_line_info(line_num, line);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_LINE_INFO], start, retval != 0, line_num, 0, 0);
+	return retval;
+}
+
+int dsl_get_line_stats(int line_num, struct dsl_line_channel_stats *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = intel_get_line_stats(line_num, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_LINE_STATS], start, retval != 0, line_num, 0, 0);
+	return retval;
+}
+
+int dsl_get_line_stats_interval(int line_num, enum dsl_stats_type type, struct dsl_line_stats_interval *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = intel_get_line_stats_interval(line_num, type, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_LINE_STATS_INTERVAL], start, retval != 0, line_num, type, 0);
+	return retval;
+}
+
+int dsl_get_channel_info(int chan_num, struct dsl_channel *channel)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = intel_get_channel_info(chan_num, channel);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_CHANNEL_INFO], start, retval != 0, chan_num, 0, 0);
+	return retval;
+}
+
+int dsl_get_channel_stats(int chan_num, struct dsl_line_channel_stats *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = intel_get_channel_stats(chan_num, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_CHANNEL_STATS], start, retval != 0, chan_num, 0, 0);
+	return retval;
+}
+
+int dsl_get_channel_stats_interval(int chan_num, enum dsl_stats_type type, struct dsl_channel_stats_interval *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = intel_get_channel_stats_interval(chan_num, type, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_CHANNEL_STATS_INTERVAL], start, retval != 0, chan_num, type, 0);
+	return retval;
+}
+
+int dsl_get_stats_all(int line_num, struct dsl_stats_all *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = intel_get_stats_all(line_num, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_STATS_ALL], start, retval != 0, line_num, 0, 0);
 	return retval;
 }
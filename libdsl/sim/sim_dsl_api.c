@@ -0,0 +1,794 @@
+/*
+ * sim_dsl_api.c - simulated DSL lines for running dslmngr without a modem
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: anjan.chanda@iopsys.eu
+ *         yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <syslog.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "xdsl.h"
+#include "utils.h"
+#include "trace.h"
+
+/**
+ * The simulator is configured with the following environment variables which are read on first use.
+ *
+ *   XDSL_SIM_LINES      Number of lines, each with one channel (default 1)
+ *   XDSL_SIM_SEED       Seed of the line model. The same seed gives the same line history (default 1)
+ *   XDSL_SIM_LATENCY    Latency in microseconds added to each call to mimic DSL FAPI (default 0)
+ *   XDSL_SIM_JITTER     Maximum deviation in microseconds from XDSL_SIM_LATENCY (default 0)
+ *   XDSL_SIM_TIMESCALE  Number of simulated seconds per real second (default 1)
+ *
+ * The model advances in steps of one simulated second. The state after n seconds only depends on
+ * the seed, so two runs with the same seed see the same line history at the same uptime.
+ */
+#define SIM_MAX_LINES		XDSL_MAX_LINES
+
+#define SIM_TARGET_MARGIN	60	/* Target noise margin in 0.1dB */
+#define SIM_SRA_MARGIN_LOW	30	/* Seamless rate adaptation is triggered below this margin... */
+#define SIM_SRA_MARGIN_HIGH	100	/* ...or above this one */
+#define SIM_SRA_PERIOD		10	/* Seconds between two rate adaptations */
+#define SIM_TRAINING_MIN	25	/* Minimum duration of a retrain in seconds */
+#define SIM_TRAINING_MAX	60	/* Maximum duration of a retrain in seconds */
+#define SIM_SES_CRC		18	/* CRC errors within one second making it severely errored */
+
+#define SIM_TONES			4096	/* VDSL2 profile 17a */
+#define SIM_TONES_GROUP		8	/* Group size of SNR, QLN and HLOG for 4096 tones as per G.997.1 */
+#define SIM_TX_PSD			-600	/* Transmit PSD in 0.1dBm/Hz */
+#define SIM_QLN_FLOOR		-1400	/* Quiet line noise in 0.1dBm/Hz */
+#define SIM_SNR_GAP			97	/* SNR gap of the bit loading in 0.1dB */
+
+#define SIM_QUARTER_HOUR	900
+#define SIM_DAY				86400
+
+struct sim_dir {
+	long attenuation;		/* 0.1dB */
+	long power;				/* 0.1dBmV */
+	unsigned long attainable;	/* Maximum attainable rate without noise in kbps */
+	unsigned long rate;		/* Current rate in kbps, 0 if not in showtime */
+	long margin;			/* 0.1dB */
+	long margin_offset;		/* Margin the line would have without any noise in 0.1dB */
+	long noise;				/* Slowly varying noise on top of the line's floor in 0.1dB */
+	long impulse;			/* Remaining impulse noise in 0.1dB */
+};
+
+struct sim_line {
+	uint64_t rng;
+	uint64_t step;			/* Simulated seconds since start */
+
+	bool showtime;
+	uint64_t training_left;
+	unsigned int loop_length;	/* meters */
+	struct sim_dir us, ds;
+	unsigned int retrains;
+
+	uint64_t showtime_begin;
+	uint64_t last_showtime_begin;
+	uint64_t quarter_hour_begin;
+	uint64_t current_day_begin;
+
+	/* Interval counters indexed by "enum dsl_stats_type" - DSL_STATS_TOTAL */
+	struct dsl_line_stats_interval line_iv[DSL_STATS_INTERVAL_NUM];
+	struct dsl_channel_stats_interval chan_iv[DSL_STATS_INTERVAL_NUM];
+};
+
+static struct {
+	pthread_mutex_t lock;
+	bool initialized;
+	int line_num;
+	uint64_t seed;
+	unsigned long latency;
+	unsigned long jitter;
+	unsigned long timescale;
+	struct timespec start;
+	uint64_t latency_rng;
+	struct sim_line lines[SIM_MAX_LINES];
+} sim = {
+	.lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+const struct dsl_ops xdsl_ops = {
+	.get_line_info = dsl_get_line_info,
+	.get_line_stats = dsl_get_line_stats,
+	.get_line_stats_interval = dsl_get_line_stats_interval,
+	.get_channel_info = dsl_get_channel_info,
+	.get_channel_stats = dsl_get_channel_stats,
+	.get_channel_stats_interval = dsl_get_channel_stats_interval,
+	.get_stats_all = dsl_get_stats_all,
+	.get_line_tones = dsl_get_line_tones
+};
+
+struct dsl_trace_point dsl_trace_points[__DSL_TRACE_OPS_MAX] = {
+	DSL_TRACE_OPS_POINTS
+};
+
+const int dsl_trace_point_num = __DSL_TRACE_OPS_MAX;
+
+/* splitmix64, small and good enough to drive the model */
+static uint64_t sim_rand(uint64_t *state)
+{
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+/* Uniformly distributed in [min, max] */
+static long sim_rand_range(uint64_t *state, long min, long max)
+{
+	return min + (long)(sim_rand(state) % (uint64_t)(max - min + 1));
+}
+
+/* A cheap event count whose mean is mean_x16 / 16 */
+static unsigned int sim_rand_count(uint64_t *state, long mean_x16)
+{
+	if (mean_x16 <= 0)
+		return 0;
+
+	return (unsigned int)((sim_rand(state) % (uint64_t)(2 * mean_x16 + 1)) / 16);
+}
+
+static unsigned long sim_env(const char *name, unsigned long def)
+{
+	const char *val = getenv(name);
+
+	return val && *val ? strtoul(val, NULL, 0) : def;
+}
+
+static void sim_line_train(struct sim_line *l)
+{
+	struct sim_dir *dirs[] = { &l->us, &l->ds };
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		struct sim_dir *d = dirs[i];
+		long loss = d->noise + d->impulse;
+		long attainable = (long)d->attainable - loss * (long)d->attainable / 400;
+
+		/* Train at the rate which leaves the target margin with the noise present right now */
+		if (attainable < (long)d->attainable / 20)
+			attainable = d->attainable / 20;
+		d->rate = (unsigned long)attainable * (1000 - SIM_TARGET_MARGIN) / 1000;
+		d->margin_offset = SIM_TARGET_MARGIN + loss;
+		d->margin = SIM_TARGET_MARGIN;
+	}
+}
+
+static void sim_line_init(struct sim_line *l, int line_num)
+{
+	memset(l, 0, sizeof(*l));
+	l->rng = sim.seed * 0x100000001B3ULL + (uint64_t)line_num;
+
+	l->loop_length = (unsigned int)sim_rand_range(&l->rng, 150, 1200);
+	l->ds.attenuation = l->loop_length * 35 / 100;
+	l->us.attenuation = l->loop_length * 28 / 100;
+	l->ds.power = 125 - (long)l->loop_length / 100;
+	l->us.power = 133 - (long)l->loop_length / 200;
+	l->ds.attainable = 150000 - l->loop_length * 100;
+	l->us.attainable = 60000 - l->loop_length * 40;
+
+	/* Lines come up after a first training */
+	l->training_left = (uint64_t)sim_rand_range(&l->rng, SIM_TRAINING_MIN, SIM_TRAINING_MAX);
+}
+
+static void sim_line_enter_showtime(struct sim_line *l)
+{
+	l->showtime = true;
+	l->last_showtime_begin = l->showtime_begin;
+	l->showtime_begin = l->step;
+	l->line_iv[DSL_STATS_LASTSHOWTIME - DSL_STATS_TOTAL] = l->line_iv[DSL_STATS_SHOWTIME - DSL_STATS_TOTAL];
+	l->chan_iv[DSL_STATS_LASTSHOWTIME - DSL_STATS_TOTAL] = l->chan_iv[DSL_STATS_SHOWTIME - DSL_STATS_TOTAL];
+	memset(&l->line_iv[DSL_STATS_SHOWTIME - DSL_STATS_TOTAL], 0, sizeof(l->line_iv[0]));
+	memset(&l->chan_iv[DSL_STATS_SHOWTIME - DSL_STATS_TOTAL], 0, sizeof(l->chan_iv[0]));
+	sim_line_train(l);
+}
+
+static void sim_line_retrain(struct sim_line *l)
+{
+	l->showtime = false;
+	l->retrains++;
+	l->us.rate = l->ds.rate = 0;
+	l->training_left = (uint64_t)sim_rand_range(&l->rng, SIM_TRAINING_MIN, SIM_TRAINING_MAX);
+}
+
+static void sim_dir_noise(struct sim_line *l, struct sim_dir *d)
+{
+	/* Mean reverting random walk plus rare impulse noise decaying within seconds */
+	d->noise += -d->noise / 32 + sim_rand_range(&l->rng, -4, 4);
+	if (sim_rand(&l->rng) % 1800 == 0)
+		d->impulse += sim_rand_range(&l->rng, 30, 120);
+	else
+		d->impulse = d->impulse * 3 / 4;
+}
+
+/* Seamless rate adaptation trades rate for margin, 0.5% of the rate per 0.1dB */
+static void sim_dir_sra(struct sim_dir *d)
+{
+	long delta = d->margin - SIM_TARGET_MARGIN;
+	unsigned long rate;
+
+	if (d->margin >= SIM_SRA_MARGIN_LOW && d->margin <= SIM_SRA_MARGIN_HIGH)
+		return;
+
+	rate = d->rate * (unsigned long)(1000 + delta * 5) / 1000;
+	if (rate > d->attainable) {
+		delta = ((long)d->attainable * 1000 / (long)d->rate - 1000) / 5;
+		rate = d->attainable;
+	}
+	d->rate = rate;
+	d->margin_offset -= delta;
+	d->margin -= delta;
+}
+
+static void sim_dir_errors(struct sim_line *l, const struct sim_dir *d, unsigned int *fec,
+		unsigned int *crc, unsigned int *hec)
+{
+	long margin = d->margin;
+
+	/* FEC corrections grow with the rate and as the margin shrinks, CRC errors only on low margin */
+	*fec = sim_rand_count(&l->rng, margin < 150 ? (150 - margin) * (long)(d->rate / 1000) / 8 : 0);
+	*crc = sim_rand_count(&l->rng, margin < 30 ? (30 - margin) * 16 : 0);
+	*hec = *crc ? sim_rand_count(&l->rng, (long)*crc * 8) : 0;
+}
+
+static void sim_line_step(struct sim_line *l)
+{
+	unsigned int fec_ds = 0, crc_ds = 0, hec_ds = 0, fec_us = 0, crc_us = 0, hec_us = 0;
+	int i;
+
+	l->step++;
+	if (l->step - l->quarter_hour_begin >= SIM_QUARTER_HOUR) {
+		l->quarter_hour_begin = l->step;
+		memset(&l->line_iv[DSL_STATS_QUARTERHOUR - DSL_STATS_TOTAL], 0, sizeof(l->line_iv[0]));
+		memset(&l->chan_iv[DSL_STATS_QUARTERHOUR - DSL_STATS_TOTAL], 0, sizeof(l->chan_iv[0]));
+	}
+	if (l->step - l->current_day_begin >= SIM_DAY) {
+		l->current_day_begin = l->step;
+		memset(&l->line_iv[DSL_STATS_CURRENTDAY - DSL_STATS_TOTAL], 0, sizeof(l->line_iv[0]));
+		memset(&l->chan_iv[DSL_STATS_CURRENTDAY - DSL_STATS_TOTAL], 0, sizeof(l->chan_iv[0]));
+	}
+
+	sim_dir_noise(l, &l->us);
+	sim_dir_noise(l, &l->ds);
+
+	if (!l->showtime) {
+		if (--l->training_left == 0)
+			sim_line_enter_showtime(l);
+		return;
+	}
+
+	l->us.margin = l->us.margin_offset - l->us.noise - l->us.impulse;
+	l->ds.margin = l->ds.margin_offset - l->ds.noise - l->ds.impulse;
+
+	if (l->us.margin < 0 || l->ds.margin < 0) {
+		sim_line_retrain(l);
+		return;
+	}
+
+	if (l->step % SIM_SRA_PERIOD == 0) {
+		sim_dir_sra(&l->us);
+		sim_dir_sra(&l->ds);
+	}
+
+	sim_dir_errors(l, &l->ds, &fec_ds, &crc_ds, &hec_ds);
+	sim_dir_errors(l, &l->us, &fec_us, &crc_us, &hec_us);
+
+	/* The counters are 32 bits wide and wrap around like the real ones do */
+	for (i = 0; i < DSL_STATS_INTERVAL_NUM; i++) {
+		if (i == DSL_STATS_LASTSHOWTIME - DSL_STATS_TOTAL)
+			continue;
+
+		l->chan_iv[i].xtur_fec_errors += fec_ds;
+		l->chan_iv[i].xtuc_fec_errors += fec_us;
+		l->chan_iv[i].xtur_crc_errors += crc_ds;
+		l->chan_iv[i].xtuc_crc_errors += crc_us;
+		l->chan_iv[i].xtur_hec_errors += hec_ds;
+		l->chan_iv[i].xtuc_hec_errors += hec_us;
+		if (crc_ds || crc_us)
+			l->line_iv[i].errored_secs++;
+		if (crc_ds >= SIM_SES_CRC || crc_us >= SIM_SES_CRC)
+			l->line_iv[i].severely_errored_secs++;
+	}
+}
+
+static void sim_init(void)
+{
+	int i;
+
+	sim.line_num = (int)sim_env("XDSL_SIM_LINES", 1);
+	if (sim.line_num < 1)
+		sim.line_num = 1;
+	else if (sim.line_num > SIM_MAX_LINES)
+		sim.line_num = SIM_MAX_LINES;
+	sim.seed = sim_env("XDSL_SIM_SEED", 1);
+	sim.latency = sim_env("XDSL_SIM_LATENCY", 0);
+	sim.jitter = sim_env("XDSL_SIM_JITTER", 0);
+	sim.timescale = sim_env("XDSL_SIM_TIMESCALE", 1);
+	sim.latency_rng = ~sim.seed;
+	clock_gettime(CLOCK_MONOTONIC, &sim.start);
+
+	for (i = 0; i < sim.line_num; i++)
+		sim_line_init(&sim.lines[i], i);
+
+	sim.initialized = true;
+}
+
+/**
+	This function advances the model of a line to the current time and returns it locked.
+
+	\param line_num
+		The line number which starts with 0.
+
+	\return
+		Returns the line on success with sim.lock held. Otherwise NULL is returned.
+*/
+static struct sim_line *sim_line_get(int line_num)
+{
+	struct timespec now;
+	int64_t elapsed_us;
+	uint64_t target;
+	struct sim_line *l;
+
+	pthread_mutex_lock(&sim.lock);
+	if (!sim.initialized)
+		sim_init();
+
+	if (line_num < 0 || line_num >= sim.line_num) {
+		pthread_mutex_unlock(&sim.lock);
+		return NULL;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	elapsed_us = (int64_t)(now.tv_sec - sim.start.tv_sec) * 1000000 +
+		(now.tv_nsec - sim.start.tv_nsec) / 1000;
+	target = elapsed_us > 0 ? (uint64_t)elapsed_us * sim.timescale / 1000000 : 0;
+
+	l = &sim.lines[line_num];
+	while (l->step < target)
+		sim_line_step(l);
+
+	return l;
+}
+
+static void sim_line_put(void)
+{
+	pthread_mutex_unlock(&sim.lock);
+}
+
+/* Mimics the time spent in the driver, called without holding the lock */
+static void sim_delay(void)
+{
+	struct timespec ts;
+	long delay;
+
+	if (sim.latency == 0 && sim.jitter == 0)
+		return;
+
+	pthread_mutex_lock(&sim.lock);
+	delay = (long)sim.latency + (sim.jitter ?
+			sim_rand_range(&sim.latency_rng, -(long)sim.jitter, (long)sim.jitter) : 0);
+	pthread_mutex_unlock(&sim.lock);
+
+	if (delay <= 0)
+		return;
+
+	ts.tv_sec = delay / 1000000;
+	ts.tv_nsec = (delay % 1000000) * 1000;
+	nanosleep(&ts, NULL);
+}
+
+int dsl_get_line_number(void)
+{
+	pthread_mutex_lock(&sim.lock);
+	if (!sim.initialized)
+		sim_init();
+	pthread_mutex_unlock(&sim.lock);
+
+	return sim.line_num;
+}
+
+int dsl_get_channel_number(void)
+{
+	return dsl_get_line_number();
+}
+
+static void sim_xtse_set(unsigned char *xtse, int bit)
+{
+	xtse[(bit - 1) / 8] |= 1 << ((bit - 1) % 8);
+}
+
+static void sim_fill_sequence(dsl_long_sequence_t *seq, long base, int count)
+{
+	int i;
+
+	for (seq->count = 0, i = 0; i < count; i++)
+		seq->array[seq->count++] = base + i * 3;
+}
+
+static int sim_get_line_info(int line_num, struct dsl_line *line)
+{
+	struct sim_line *l;
+	int i;
+
+	sim_delay();
+	if ((l = sim_line_get(line_num)) == NULL)
+		return -1;
+
+	memset(line, 0, sizeof(*line));
+	line->status = l->showtime ? IF_UP : IF_DOWN;
+	line->upstream = true;
+	snprintf(line->firmware_version, sizeof(line->firmware_version), "sim-1.0.%u", l->retrains);
+	line->link_status = l->showtime ? LINK_UP :
+		(l->training_left > SIM_TRAINING_MIN / 2 ? LINK_INITIALIZING : LINK_ESTABLISHING);
+
+	line->standard_supported.use_xtse = true;
+	for (i = T1_413; i <= G_993_2_JAPAN; i++) {
+		if (i != ETSI_101_388 && !(i >= 13 && i <= 18) && !(i >= 27 && i <= 28) && !(i >= 53 && i <= 56))
+			sim_xtse_set(line->standard_supported.xtse, i);
+	}
+	line->standard_used.use_xtse = true;
+	if (l->showtime)
+		sim_xtse_set(line->standard_used.xtse, G_993_2_EUROPE);
+
+	line->line_encoding = LE_DMT;
+	line->allowed_profiles = VDSL2_8a | VDSL2_8b | VDSL2_8c | VDSL2_8d | VDSL2_12a | VDSL2_12b | VDSL2_17a;
+	line->current_profile = l->showtime ? VDSL2_17a : 0;
+	line->power_management_state = l->showtime ? DSL_L0 : DSL_L3;
+	line->success_failure_cause = 0;
+
+	line->upbokler_pb.count = 3;
+	line->upbokler_pb.array[0] = l->loop_length / 100;
+	line->upbokler_pb.array[1] = l->loop_length / 80;
+	line->upbokler_pb.array[2] = l->loop_length / 60;
+	line->rxthrsh_ds.count = 3;
+	line->rxthrsh_ds.array[0] = 18;
+	line->rxthrsh_ds.array[1] = 18;
+	line->rxthrsh_ds.array[2] = 2048;
+
+	line->act_ra_mode.us = line->act_ra_mode.ds = 3;
+	line->last_state_transmitted.us = line->last_state_transmitted.ds = l->showtime ? 0 : 5;
+	line->us0_mask = 62451;
+	line->trellis.us = line->trellis.ds = 1;
+	line->line_number = line_num;
+
+	if (l->showtime) {
+		line->max_bit_rate.us = l->us.attainable * 100 / (100 + l->us.noise / 10 + l->us.impulse / 10 + 1);
+		line->max_bit_rate.ds = l->ds.attainable * 100 / (100 + l->ds.noise / 10 + l->ds.impulse / 10 + 1);
+		line->noise_margin.us = l->us.margin;
+		line->noise_margin.ds = l->ds.margin;
+		sim_fill_sequence(&line->snr_mpb_us, l->us.margin - 3, 3);
+		sim_fill_sequence(&line->snr_mpb_ds, l->ds.margin - 3, 3);
+		line->power.us = l->us.power;
+		line->power.ds = l->ds.power;
+	}
+	line->attenuation.us = l->us.attenuation;
+	line->attenuation.ds = l->ds.attenuation;
+
+	strcpy(line->xtur_vendor, "53494D4C00000000");
+	strcpy(line->xtur_country, "B500");
+	strcpy(line->xtuc_vendor, "53494D4300000000");
+	strcpy(line->xtuc_country, "B500");
+
+	sim_line_put();
+	return 0;
+}
+
+static void sim_fill_stats(const struct sim_line *l, struct dsl_line_channel_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->total_start = (unsigned int)l->step;
+	stats->showtime_start = l->showtime ? (unsigned int)(l->step - l->showtime_begin) : 0;
+	stats->last_showtime_start = l->last_showtime_begin || l->retrains ?
+		(unsigned int)(l->step - l->last_showtime_begin) : 0;
+	stats->current_day_start = (unsigned int)(l->step - l->current_day_begin);
+	stats->quarter_hour_start = (unsigned int)(l->step - l->quarter_hour_begin);
+}
+
+static int sim_get_line_stats(int line_num, struct dsl_line_channel_stats *stats)
+{
+	struct sim_line *l;
+
+	sim_delay();
+	if ((l = sim_line_get(line_num)) == NULL)
+		return -1;
+
+	sim_fill_stats(l, stats);
+
+	sim_line_put();
+	return 0;
+}
+
+static int sim_get_line_stats_interval(int line_num, enum dsl_stats_type type, struct dsl_line_stats_interval *stats)
+{
+	struct sim_line *l;
+
+	if (type < DSL_STATS_TOTAL || type > DSL_STATS_QUARTERHOUR) {
+		LIBDSL_LOG(LOG_ERR, "Unknown interval type for DSL line statistics, %d\n", type);
+		return -1;
+	}
+
+	sim_delay();
+	if ((l = sim_line_get(line_num)) == NULL)
+		return -1;
+
+	*stats = l->line_iv[type - DSL_STATS_TOTAL];
+
+	sim_line_put();
+	return 0;
+}
+
+static int sim_get_channel_info(int chan_num, struct dsl_channel *channel)
+{
+	struct sim_line *l;
+
+	sim_delay();
+	if ((l = sim_line_get(chan_num)) == NULL)
+		return -1;
+
+	memset(channel, 0, sizeof(*channel));
+	channel->status = l->showtime ? IF_UP : IF_DOWN;
+	channel->link_encapsulation_supported = G_992_3_ANNEK_K_ATM | G_993_2_ANNEK_K_PTM;
+	channel->link_encapsulation_used = G_993_2_ANNEK_K_PTM;
+	if (l->showtime) {
+		channel->intlvdepth = 1;
+		channel->intlvblock = 255;
+		channel->nfec = 255;
+		channel->rfec = 16;
+		channel->lsymb = (int)(l->ds.rate / 4);
+		channel->curr_rate.us = l->us.rate;
+		channel->curr_rate.ds = l->ds.rate;
+		channel->actndr.us = l->us.rate;
+		channel->actndr.ds = l->ds.rate;
+	}
+
+	sim_line_put();
+	return 0;
+}
+
+static int sim_get_channel_stats(int chan_num, struct dsl_line_channel_stats *stats)
+{
+	struct sim_line *l;
+
+	sim_delay();
+	if ((l = sim_line_get(chan_num)) == NULL)
+		return -1;
+
+	sim_fill_stats(l, stats);
+
+	sim_line_put();
+	return 0;
+}
+
+static int sim_get_channel_stats_interval(int chan_num, enum dsl_stats_type type, struct dsl_channel_stats_interval *stats)
+{
+	struct sim_line *l;
+
+	if (type < DSL_STATS_TOTAL || type > DSL_STATS_QUARTERHOUR) {
+		LIBDSL_LOG(LOG_ERR, "Unknown interval type for DSL channel statistics, %d\n", type);
+		return -1;
+	}
+
+	sim_delay();
+	if ((l = sim_line_get(chan_num)) == NULL)
+		return -1;
+
+	*stats = l->chan_iv[type - DSL_STATS_TOTAL];
+
+	sim_line_put();
+	return 0;
+}
+
+/* The whole bundle is taken under one lock and costs the latency of a single call */
+static int sim_get_stats_all(int line_num, struct dsl_stats_all *stats)
+{
+	struct sim_line *l;
+
+	sim_delay();
+	if ((l = sim_line_get(line_num)) == NULL)
+		return -1;
+
+	sim_fill_stats(l, &stats->line);
+	stats->channel = stats->line;
+	memcpy(stats->line_intervals, l->line_iv, sizeof(stats->line_intervals));
+	memcpy(stats->channel_intervals, l->chan_iv, sizeof(stats->channel_intervals));
+
+	sim_line_put();
+	return 0;
+}
+
+/* Simplified 998ADE17 band plan */
+static const struct {
+	unsigned int first;
+	unsigned int last;
+	bool upstream;
+} sim_bands[] = {
+	{ 6, 32, true },
+	{ 33, 859, false },
+	{ 860, 1971, true },
+	{ 1972, 2782, false },
+	{ 2783, SIM_TONES - 1, true },
+};
+
+static bool sim_tone_used(unsigned int tone, bool upstream)
+{
+	unsigned int i;
+
+	for (i = 0; i < sizeof(sim_bands) / sizeof(sim_bands[0]); i++) {
+		if (tone >= sim_bands[i].first && tone <= sim_bands[i].last)
+			return sim_bands[i].upstream == upstream;
+	}
+
+	return false;
+}
+
+/* Attenuation of a tone in 0.1dB, growing with the loop length and the frequency */
+static long sim_tone_attenuation(const struct sim_line *l, unsigned int tone)
+{
+	return (long)l->loop_length * (20 + tone / 8) / 1000;
+}
+
+/* Quiet line noise of a tone in 0.1dBm/Hz, a fixed ripple of the line on top of its noise */
+static long sim_tone_qln(const struct sim_line *l, const struct sim_dir *d, unsigned int tone)
+{
+	long ripple = (long)(((tone ^ l->loop_length) * 2654435761U) >> 27) - 16;
+
+	return SIM_QLN_FLOOR + ripple + d->noise + d->impulse;
+}
+
+static long sim_clamp(long value, long min, long max)
+{
+	return value < min ? min : (value > max ? max : value);
+}
+
+static uint16_t sim_tone_value(const struct sim_line *l, enum dsl_tones_type type, bool upstream,
+		unsigned int tone)
+{
+	const struct sim_dir *d = upstream ? &l->us : &l->ds;
+	long atten = sim_tone_attenuation(l, tone);
+	long qln = sim_tone_qln(l, d, tone);
+	long snr = SIM_TX_PSD - atten - qln;
+
+	switch (type) {
+	case DSL_TONES_BITS:
+		/* Loaded at training, i.e. with the noise the line then had, which margin_offset holds */
+		if (!sim_tone_used(tone, upstream))
+			return 0;
+		snr = SIM_TX_PSD - atten - SIM_QLN_FLOOR - (d->margin_offset - SIM_TARGET_MARGIN);
+		return (uint16_t)sim_clamp((snr - SIM_SNR_GAP - SIM_TARGET_MARGIN) / 30, 0, 15);
+	case DSL_TONES_SNR:
+		return sim_tone_used(tone, upstream) ? (uint16_t)sim_clamp((snr + 320) / 5, 0, 254) : 255;
+	case DSL_TONES_QLN:
+		return sim_tone_used(tone, upstream) ? (uint16_t)sim_clamp((-230 - qln) / 5, 0, 254) : 255;
+	case DSL_TONES_HLOG:
+		return sim_tone_used(tone, upstream) ? (uint16_t)sim_clamp(60 + atten, 0, 1022) : 1023;
+	default:
+		return 0;
+	}
+}
+
+/* The data are only available in showtime. Only the bits are per tone, the others per group */
+static int sim_get_line_tones(int line_num, enum dsl_tones_type type, bool upstream, struct dsl_tones *tones)
+{
+	struct sim_line *l;
+	unsigned int i;
+
+	if (type < 0 || type >= __DSL_TONES_MAX)
+		return -1;
+
+	sim_delay();
+	if ((l = sim_line_get(line_num)) == NULL)
+		return -1;
+
+	if (!l->showtime) {
+		sim_line_put();
+		return -1;
+	}
+
+	tones->group_size = type == DSL_TONES_BITS ? 1 : SIM_TONES_GROUP;
+	tones->count = SIM_TONES / tones->group_size;
+	for (i = 0; i < tones->count; i++)
+		tones->values[i] = sim_tone_value(l, type, upstream, i * tones->group_size);
+
+	sim_line_put();
+	return 0;
+}
+
+/**
+ * The entries of xdsl_ops are traced around the simulation, including the latency added to mimic
+ * DSL FAPI.
+ */
+int dsl_get_line_info(int line_num, struct dsl_line *line)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = sim_get_line_info(line_num, line);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_LINE_INFO], start, retval != 0, line_num, 0, 0);
+	return retval;
+}
+
+int dsl_get_line_stats(int line_num, struct dsl_line_channel_stats *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = sim_get_line_stats(line_num, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_LINE_STATS], start, retval != 0, line_num, 0, 0);
+	return retval;
+}
+
+int dsl_get_line_stats_interval(int line_num, enum dsl_stats_type type, struct dsl_line_stats_interval *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = sim_get_line_stats_interval(line_num, type, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_LINE_STATS_INTERVAL], start, retval != 0, line_num, type, 0);
+	return retval;
+}
+
+int dsl_get_channel_info(int chan_num, struct dsl_channel *channel)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = sim_get_channel_info(chan_num, channel);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_CHANNEL_INFO], start, retval != 0, chan_num, 0, 0);
+	return retval;
+}
+
+int dsl_get_channel_stats(int chan_num, struct dsl_line_channel_stats *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = sim_get_channel_stats(chan_num, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_CHANNEL_STATS], start, retval != 0, chan_num, 0, 0);
+	return retval;
+}
+
+int dsl_get_channel_stats_interval(int chan_num, enum dsl_stats_type type, struct dsl_channel_stats_interval *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = sim_get_channel_stats_interval(chan_num, type, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_CHANNEL_STATS_INTERVAL], start, retval != 0, chan_num, type, 0);
+	return retval;
+}
+
+int dsl_get_stats_all(int line_num, struct dsl_stats_all *stats)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = sim_get_stats_all(line_num, stats);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_STATS_ALL], start, retval != 0, line_num, 0, 0);
+	return retval;
+}
+
+int dsl_get_line_tones(int line_num, enum dsl_tones_type type, bool upstream, struct dsl_tones *tones)
+{
+	uint64_t start = dsl_trace_begin();
+	int retval = sim_get_line_tones(line_num, type, upstream, tones);
+
+	dsl_trace_end(&dsl_trace_points[DSL_TRACE_GET_LINE_TONES], start, retval != 0, line_num, type, upstream);
+	return retval;
+}
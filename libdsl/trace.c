@@ -0,0 +1,122 @@
+/*
+ * trace.c - counters and latencies of the backend calls
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "xdsl.h"
+#include "trace.h"
+
+/**
+ * The calls are accounted under a single lock, which is only held for a few additions since the
+ * driver calls take far longer. The slow calls are kept in a ring of DSL_SLOW_CALLS_MAX entries.
+ */
+static pthread_mutex_t trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long slow_threshold;
+static struct dsl_slow_call slow_calls[DSL_SLOW_CALLS_MAX];
+static int slow_next;
+static int slow_count;
+
+uint64_t dsl_trace_begin(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+void dsl_trace_end(struct dsl_trace_point *point, uint64_t start, bool failed, int arg0, int arg1, int arg2)
+{
+	unsigned long latency = (unsigned long)(dsl_trace_begin() - start);
+	struct dsl_call_stats *stats = &point->stats;
+	struct dsl_slow_call *slow;
+
+	pthread_mutex_lock(&trace_lock);
+	if (stats->calls == 0 || latency < stats->min_us)
+		stats->min_us = latency;
+	if (latency > stats->max_us)
+		stats->max_us = latency;
+	stats->total_us += latency;
+	stats->calls++;
+	if (failed)
+		stats->errors++;
+
+	if (slow_threshold > 0 && latency >= slow_threshold) {
+		slow = &slow_calls[slow_next];
+		slow->name = point->name;
+		snprintf(slow->args, sizeof(slow->args), point->args_fmt, arg0, arg1, arg2);
+		slow->failed = failed;
+		slow->latency_us = latency;
+		slow->time = time(NULL);
+
+		slow_next = (slow_next + 1) % DSL_SLOW_CALLS_MAX;
+		if (slow_count < DSL_SLOW_CALLS_MAX)
+			slow_count++;
+	}
+	pthread_mutex_unlock(&trace_lock);
+}
+
+int dsl_get_call_stats(struct dsl_call_stats *stats, int size)
+{
+	int i;
+
+	pthread_mutex_lock(&trace_lock);
+	for (i = 0; i < dsl_trace_point_num && i < size; i++) {
+		stats[i] = dsl_trace_points[i].stats;
+		stats[i].name = dsl_trace_points[i].name;
+	}
+	pthread_mutex_unlock(&trace_lock);
+
+	return dsl_trace_point_num;
+}
+
+void dsl_set_slow_call_threshold(unsigned long usec)
+{
+	pthread_mutex_lock(&trace_lock);
+	slow_threshold = usec;
+	pthread_mutex_unlock(&trace_lock);
+}
+
+int dsl_get_slow_calls(struct dsl_slow_call *calls, int size)
+{
+	int i;
+
+	pthread_mutex_lock(&trace_lock);
+	for (i = 0; i < slow_count && i < size; i++)
+		calls[i] = slow_calls[(slow_next - 1 - i + DSL_SLOW_CALLS_MAX) % DSL_SLOW_CALLS_MAX];
+	pthread_mutex_unlock(&trace_lock);
+
+	return i;
+}
+
+void dsl_reset_call_stats(void)
+{
+	int i;
+
+	pthread_mutex_lock(&trace_lock);
+	for (i = 0; i < dsl_trace_point_num; i++)
+		memset(&dsl_trace_points[i].stats, 0, sizeof(dsl_trace_points[i].stats));
+	slow_next = 0;
+	slow_count = 0;
+	pthread_mutex_unlock(&trace_lock);
+}
@@ -0,0 +1,90 @@
+/*
+ * trace.h - private header file of the tracing of the backend calls
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "xdsl.h"
+
+/** struct dsl_trace_point - A traced backend function */
+struct dsl_trace_point {
+	/** Name of the function */
+	const char *name;
+	/** printf() format of the arguments of the function, which are up to three integers */
+	const char *args_fmt;
+	/** Counters of the calls, whose name is left unset */
+	struct dsl_call_stats stats;
+};
+
+/**
+ * The backend defines the traced functions, i.e. its entries of struct dsl_ops and the driver
+ * functions which they call.
+ */
+extern struct dsl_trace_point dsl_trace_points[];
+extern const int dsl_trace_point_num;
+
+#define DSL_TRACE_POINT(id, fn_name, fmt) [id] = { .name = fn_name, .args_fmt = fmt }
+
+/** The entries of struct dsl_ops come first, followed by the backend specific functions */
+enum {
+	DSL_TRACE_GET_LINE_INFO,
+	DSL_TRACE_GET_LINE_STATS,
+	DSL_TRACE_GET_LINE_STATS_INTERVAL,
+	DSL_TRACE_GET_CHANNEL_INFO,
+	DSL_TRACE_GET_CHANNEL_STATS,
+	DSL_TRACE_GET_CHANNEL_STATS_INTERVAL,
+	DSL_TRACE_GET_STATS_ALL,
+	DSL_TRACE_GET_LINE_TONES,
+	__DSL_TRACE_OPS_MAX
+};
+
+#define DSL_TRACE_OPS_POINTS \
+	DSL_TRACE_POINT(DSL_TRACE_GET_LINE_INFO, "get_line_info", "line=%d"), \
+	DSL_TRACE_POINT(DSL_TRACE_GET_LINE_STATS, "get_line_stats", "line=%d"), \
+	DSL_TRACE_POINT(DSL_TRACE_GET_LINE_STATS_INTERVAL, "get_line_stats_interval", "line=%d type=%d"), \
+	DSL_TRACE_POINT(DSL_TRACE_GET_CHANNEL_INFO, "get_channel_info", "channel=%d"), \
+	DSL_TRACE_POINT(DSL_TRACE_GET_CHANNEL_STATS, "get_channel_stats", "channel=%d"), \
+	DSL_TRACE_POINT(DSL_TRACE_GET_CHANNEL_STATS_INTERVAL, "get_channel_stats_interval", "channel=%d type=%d"), \
+	DSL_TRACE_POINT(DSL_TRACE_GET_STATS_ALL, "get_stats_all", "line=%d"), \
+	DSL_TRACE_POINT(DSL_TRACE_GET_LINE_TONES, "get_line_tones", "line=%d type=%d upstream=%d")
+
+/**
+ * This function returns the monotonic time in microseconds at which a traced call begins.
+ */
+uint64_t dsl_trace_begin(void);
+
+/**
+ * This function accounts a traced call which began at start. The arguments are only formatted
+ * if the call is recorded as a slow one.
+ */
+void dsl_trace_end(struct dsl_trace_point *point, uint64_t start, bool failed, int arg0, int arg1, int arg2);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* _TRACE_H */
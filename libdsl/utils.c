@@ -0,0 +1,142 @@
+/*
+ * utils.c - string helpers shared by the libdsl backends
+ *
+ * Copyright (C) 2019 iopsys Software Solutions AB. All rights reserved.
+ *
+ * Author: yalu.zhang@iopsys.eu
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * version 2 as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+#include <limits.h>
+#include <stddef.h>
+
+#include "utils.h"
+
+static const char hex_digits[] = "0123456789ABCDEF";
+
+static inline int is_space(char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**
+ * This function parses the next integer of a comma-separated list the same way as atoi(), i.e.
+ * leading white spaces and a sign are accepted and the parsing stops at the first non-digit.
+ * The value saturates at the limits of int instead of being undefined. Empty items are skipped
+ * as strtok_r() does.
+ *
+ * \return Returns 1 with *str moved past the item, or 0 at the end of the list.
+ */
+static int parse_next_int(const char **str, long *value)
+{
+	const char *p = *str;
+	long val = 0, limit;
+	int negative = 0;
+
+	while (*p == ',')
+		p++;
+	if (*p == '\0')
+		return 0;
+
+	while (is_space(*p))
+		p++;
+	if (*p == '-' || *p == '+')
+		negative = *p++ == '-';
+
+	limit = negative ? -(long)INT_MIN : INT_MAX;
+	for (; *p >= '0' && *p <= '9'; p++) {
+		val = val * 10 + (*p - '0');
+		if (val > limit)
+			val = limit;
+	}
+
+	// Skip the garbage if any till the end of the item
+	while (*p != ',' && *p != '\0')
+		p++;
+
+	*value = negative ? -val : val;
+	*str = p;
+	return 1;
+}
+
+int dsl_parse_long_list(const char *str, long *array, int size)
+{
+	int count = 0;
+	long value;
+
+	if (str == NULL)
+		return 0;
+
+	while (count < size && parse_next_int(&str, &value))
+		array[count++] = value;
+
+	return count;
+}
+
+int dsl_parse_ulong_list(const char *str, unsigned long *array, int size)
+{
+	int count = 0;
+	long value;
+
+	if (str == NULL)
+		return 0;
+
+	// Negative values are converted as atoi()'s result would have been
+	while (count < size && parse_next_int(&str, &value))
+		array[count++] = (unsigned long)value;
+
+	return count;
+}
+
+char *dsl_list_next(char **cursor)
+{
+	char *token = *cursor, *p;
+
+	if (token == NULL)
+		return NULL;
+
+	while (*token == ',')
+		token++;
+	if (*token == '\0') {
+		*cursor = NULL;
+		return NULL;
+	}
+
+	for (p = token; *p != ',' && *p != '\0'; p++)
+		;
+	if (*p == ',')
+		*p++ = '\0';
+	*cursor = p;
+
+	return token;
+}
+
+void dsl_hex_encode(char *dst, size_t dst_size, const void *src, size_t src_len)
+{
+	const unsigned char *bytes = src;
+	size_t i;
+
+	if (dst_size == 0)
+		return;
+
+	if (src_len > (dst_size - 1) / 2)
+		src_len = (dst_size - 1) / 2;
+
+	for (i = 0; i < src_len; i++) {
+		*dst++ = hex_digits[bytes[i] >> 4];
+		*dst++ = hex_digits[bytes[i] & 0x0f];
+	}
+	*dst = '\0';
+}
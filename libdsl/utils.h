@@ -27,9 +27,31 @@ extern "C" {
 #endif
 
 #include <stdio.h>
+#include <stddef.h>
 
 #define LIBDSL_LOG(log_level, format...) fprintf(stderr, ##format)
 
+/**
+ * These functions parse a comma-separated list of integers, e.g. "12,-3,0", in a single pass
+ * without modifying it. Each item is converted as atoi() does and empty items are skipped.
+ *
+ * \return Returns the number of items stored, which is at most size.
+ */
+int dsl_parse_long_list(const char *str, long *array, int size);
+int dsl_parse_ulong_list(const char *str, unsigned long *array, int size);
+
+/**
+ * This function returns the next non-empty item of a comma-separated list, which is terminated
+ * in place, or NULL at the end of the list. *cursor must point to the list at the first call.
+ */
+char *dsl_list_next(char **cursor);
+
+/**
+ * This function encodes bytes as upper-case hexadecimal digits, e.g. "B5004946". The output is
+ * truncated to what fits in dst with its terminating '\0'.
+ */
+void dsl_hex_encode(char *dst, size_t dst_size, const void *src, size_t src_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,9 +31,10 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 
 /** Common definitions */
-#define XDSL_MAX_LINES	1
+#define XDSL_MAX_LINES	8
 
 typedef struct { long us; long ds; } dsl_long_t;
 typedef struct { unsigned long us; unsigned long ds; } dsl_ulong_t;
@@ -328,6 +329,9 @@ enum dsl_stats_type {
 	DSL_STATS_QUARTERHOUR
 };
 
+/** The number of interval statistics types defined in enum dsl_stats_type */
+#define DSL_STATS_INTERVAL_NUM (DSL_STATS_QUARTERHOUR - DSL_STATS_TOTAL + 1)
+
 /** enum dsl_link_encapsulation - Type of link encapsulation method defineds as bit maps */
 enum dsl_link_encapsulation {
 	G_992_3_ANNEK_K_ATM	= 1,
@@ -471,6 +475,156 @@ int dsl_get_channel_stats(int chan_num, struct dsl_line_channel_stats *stats);
  */
 int dsl_get_channel_stats_interval(int chan_num, enum dsl_stats_type type, struct dsl_channel_stats_interval *stats);
 
+/** struct dsl_stats_all - All statistics counters of a DSL line and its channel */
+struct dsl_stats_all {
+	/** Statistics counters of the line */
+	struct dsl_line_channel_stats line;
+	/** Interval statistics of the line indexed by "enum dsl_stats_type" - DSL_STATS_TOTAL */
+	struct dsl_line_stats_interval line_intervals[DSL_STATS_INTERVAL_NUM];
+	/** Statistics counters of the channel */
+	struct dsl_line_channel_stats channel;
+	/** Interval statistics of the channel indexed by "enum dsl_stats_type" - DSL_STATS_TOTAL */
+	struct dsl_channel_stats_interval channel_intervals[DSL_STATS_INTERVAL_NUM];
+};
+
+/**
+ * This function gets all statistics counters of a DSL line and its channel in one transaction,
+ * i.e. the same data as dsl_get_line_stats(), dsl_get_channel_stats() and dsl_get_*_stats_interval()
+ * for all interval types
+ *
+ * @param[in] line_num - The line number which starts with 0
+ * @param[out] stats The output parameter to receive the data
+ *
+ * @return 0 on success. Otherwise a negative value is returned
+ */
+int dsl_get_stats_all(int line_num, struct dsl_stats_all *stats);
+
+/** struct dsl_ctx_stats - Usage counters of the driver contexts which are kept open by libdsl */
+struct dsl_ctx_stats {
+	/** Number of times a context has been opened */
+	unsigned long opens;
+	/** Number of times an already open context has been reused */
+	unsigned long reuses;
+	/** Number of times opening a context has failed */
+	unsigned long open_errors;
+	/** Number of contexts which have been closed after an error in order to be reopened on next use */
+	unsigned long drops;
+};
+
+/**
+ * This function gets the usage counters of the driver contexts
+ *
+ * @param[out] stats The output parameter to receive the data
+ *
+ * @return 0 on success. Otherwise a negative value is returned
+ */
+int dsl_get_ctx_stats(struct dsl_ctx_stats *stats);
+
+/** struct dsl_call_stats - Counters of the calls of a backend function */
+struct dsl_call_stats {
+	/** Name of the function, either an entry of struct dsl_ops or a function of the driver API */
+	const char *name;
+	/** Number of calls */
+	unsigned long calls;
+	/** Number of calls which have failed */
+	unsigned long errors;
+	/** Minimum latency in microseconds */
+	unsigned long min_us;
+	/** Maximum latency in microseconds */
+	unsigned long max_us;
+	/** Total latency in microseconds, from which the average one is derived */
+	uint64_t total_us;
+};
+
+/**
+ * This function gets the counters of the calls of the backend functions, one entry per function
+ *
+ * @param[out] stats The output parameter to receive the data
+ * @param[in] size The number of entries of stats
+ *
+ * @return the number of backend functions, of which the first size ones are returned
+ */
+int dsl_get_call_stats(struct dsl_call_stats *stats, int size);
+
+/** Number of slow calls which are kept, the oldest one being replaced by the next one */
+#define DSL_SLOW_CALLS_MAX 16
+
+/** struct dsl_slow_call - A call of a backend function which has taken too long */
+struct dsl_slow_call {
+	/** Name of the function as in struct dsl_call_stats */
+	const char *name;
+	/** Arguments of the call, e.g. "line=0 type=2" */
+	char args[32];
+	/** Whether the call has failed */
+	bool failed;
+	/** Latency in microseconds */
+	unsigned long latency_us;
+	/** Time at which the call returned */
+	time_t time;
+};
+
+/**
+ * This function sets the latency from which the calls are kept as slow calls. It is 0 by default,
+ * which disables the recording of the slow calls.
+ *
+ * @param[in] usec The latency in microseconds
+ */
+void dsl_set_slow_call_threshold(unsigned long usec);
+
+/**
+ * This function gets the last slow calls, the most recent one first
+ *
+ * @param[out] calls The output parameter to receive the data
+ * @param[in] size The number of entries of calls
+ *
+ * @return the number of slow calls returned
+ */
+int dsl_get_slow_calls(struct dsl_slow_call *calls, int size);
+
+/**
+ * This function clears the counters of the calls and the slow calls
+ */
+void dsl_reset_call_stats(void);
+
+/** Maximum number of tones (sub-carriers) of a line, 8192 for VDSL2 profile 35b */
+#define DSL_MAX_TONES 8192
+
+/** enum dsl_tones_type - Per-tone data of a line, the values are those defined in G.997.1 */
+enum dsl_tones_type {
+	/** Number of bits allocated to each tone, from 0 to 15 */
+	DSL_TONES_BITS,
+	/** Signal-to-noise ratio, -32 + v / 2 dB. 255 indicates that no measurement could be done */
+	DSL_TONES_SNR,
+	/** Quiet line noise, -23 - v / 2 dBm/Hz. 255 indicates that no measurement could be done */
+	DSL_TONES_QLN,
+	/** Channel characteristics, 6 - v / 10 dB. 1023 indicates that no measurement could be done */
+	DSL_TONES_HLOG,
+	__DSL_TONES_MAX
+};
+
+/** struct dsl_tones - Per-tone data of a line in one direction */
+struct dsl_tones {
+	/** Number of tones per value, i.e. value i is that of the tones i * group_size to
+	 *  (i + 1) * group_size - 1 */
+	unsigned int group_size;
+	/** Number of values */
+	unsigned int count;
+	/** The values of the groups of tones */
+	uint16_t values[DSL_MAX_TONES];
+};
+
+/**
+ * This function gets the per-tone data of a DSL line
+ *
+ * @param[in] line_num - The line number which starts with 0
+ * @param[in] type The type of per-tone data
+ * @param[in] upstream Whether the data of the upstream direction, otherwise of the downstream one
+ * @param[out] tones The output parameter to receive the data
+ *
+ * @return 0 on success. Otherwise a negative value is returned
+ */
+int dsl_get_line_tones(int line_num, enum dsl_tones_type type, bool upstream, struct dsl_tones *tones);
+
 /**
  *  struct dsl_ops - This structure defines the DSL operations.
  *  A function pointer shall be NULL if the operation
@@ -484,6 +638,10 @@ struct dsl_ops {
 	int (*get_channel_stats)(int chan_num, struct dsl_line_channel_stats *stats);
 	int (*get_channel_stats_interval)(int chan_num, enum dsl_stats_type type,
 			struct dsl_channel_stats_interval *stats);
+	int (*get_stats_all)(int line_num, struct dsl_stats_all *stats);
+	int (*get_ctx_stats)(struct dsl_ctx_stats *stats);
+	int (*get_line_tones)(int line_num, enum dsl_tones_type type, bool upstream,
+			struct dsl_tones *tones);
 };
 
 /** This global variable must be defined for each platform specific implementation */
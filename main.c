@@ -23,11 +23,8 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <unistd.h>
-#ifndef _GNU_SOURCE
-#define _GNU_SOURCE
-#endif
-#include <pthread.h>
 #include <libubox/blobmsg.h>
 #include <libubox/blobmsg_json.h>
 #include <libubox/uloop.h>
@@ -37,34 +34,98 @@
 
 #include "dslmngr.h"
 
-#if 0 // Converting netlink to UBUS is done by inbd for now
-void *dslmngr_event_main(void *arg)
+/** struct dsl_probe - Probing of the backend, run in a thread of its own */
+static struct dsl_probe {
+	struct dsl_job job;
+	struct ubus_context *ctx;
+	uint64_t start;
+	bool failed;
+} probe;
+
+/* Thread safe, the backend probes the lines on first use only */
+static void dsl_probe_run(struct dsl_job *job)
+{
+	dsl_get_line_number();
+	dsl_get_channel_number();
+}
+
+/* Sets up everything which depends on the lines and publishes their objects */
+static int dsl_start_lines(struct ubus_context *ctx)
+{
+	if (dsl_cache_init() != 0)
+		return -1;
+
+	// By default one worker per line so that all lines can be refreshed at the same time
+	if (dslmngr_conf.workers < 0)
+		dslmngr_conf.workers = dsl_get_line_number();
+	if (dsl_worker_init(dslmngr_conf.workers) != 0)
+		return -1;
+
+	if (dsl_history_init() != 0)
+		return -1;
+
+	if (dsl_add_line_objects(ctx) != 0)
+		return -1;
+
+	// Driver notifications are optional, they are not available on all platforms
+	if (dslmngr_nl_init(ctx) != 0) {
+		DSLMNGR_LOG(LOG_WARNING, "Driver notifications are not available\n");
+		dslmngr_conf.status_ttl = 0;
+	}
+
+	return 0;
+}
+
+static void dsl_probe_done(struct dsl_job *job)
 {
-	struct ubus_context *ctx = (struct ubus_context *)arg;
+	struct dsl_probe *p = container_of(job, struct dsl_probe, job);
+
+	dslmngr_startup.probed = dsl_debug_now() - dslmngr_startup.start;
 
-	pthread_t me = pthread_self();
-	pthread_setname_np(me, "dslmngr_eventd");
+	if (dsl_start_lines(p->ctx) != 0) {
+		p->failed = true;
+		uloop_end();
+		return;
+	}
 
-	dslmngr_nl_msgs_handler(ctx);
-	return NULL;
+	dslmngr_startup.lines_ready = dsl_debug_now() - dslmngr_startup.start;
+	dslmngr_startup.ready = true;
+	DSLMNGR_LOG(LOG_INFO, "%d DSL lines ready %" PRIu64 " us after start, probed in %" PRIu64 " us\n",
+			dsl_get_line_number(), dslmngr_startup.lines_ready,
+			dslmngr_startup.probed - (p->start - dslmngr_startup.start));
 }
-#endif
 
 int main(int argc, char **argv)
 {
 	const char *ubus_socket = NULL;
 	struct ubus_context *ctx = NULL;
-	int ch, ret;
-#if 0
-	pthread_t evtid;
-	pthread_attr_t attr;
-#endif
+	int ch, ret = -1;
+
+	dslmngr_startup.start = dsl_debug_now();
 
-	while ((ch = getopt(argc, argv, "cs:")) != -1) {
+	while ((ch = getopt(argc, argv, "cm:s:H:p:t:T:w:")) != -1) {
 		switch (ch) {
+		case 'H':
+			dslmngr_conf.history_file = optarg;
+			break;
+		case 'm':
+			dslmngr_conf.metrics_addr = optarg;
+			break;
+		case 'p':
+			dslmngr_conf.history_period = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
 		case 's':
 			ubus_socket = optarg;
 			break;
+		case 't':
+			dslmngr_conf.cache_ttl = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'T':
+			dslmngr_conf.status_ttl = (unsigned int)strtoul(optarg, NULL, 10);
+			break;
+		case 'w':
+			dslmngr_conf.workers = atoi(optarg);
+			break;
 		default:
 			break;
 		}
@@ -72,22 +133,6 @@ int main(int argc, char **argv)
 	argc -= optind;
 	argv += optind;
 
-#if 0 // Converting netlink to UBUS is done by inbd for now
-	if (pthread_attr_init(&attr) == 0) {
-		struct sched_param sp;
-
-		pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
-		pthread_attr_setschedpolicy(&attr, SCHED_RR);
-		sp.sched_priority = 99;
-		pthread_attr_setschedparam(&attr, &sp);
-	}
-
-	if (pthread_create(&evtid, &attr, &dslmngr_event_main, ctx) != 0)
-		fprintf(stderr, "pthread_create error!\n");
-
-	dslmngr_cmd_main(ctx);
-#endif
-
 	uloop_init();
 	ctx = ubus_connect(ubus_socket);
 	if (!ctx) {
@@ -97,10 +142,31 @@ int main(int argc, char **argv)
 
 	ubus_add_uloop(ctx);
 
+	// Published right away, the methods fail with UBUS_STATUS_NO_DATA until the lines are ready
 	if (dsl_add_ubus_objects(ctx) != 0)
 		goto __ret;
+	dslmngr_startup.ubus_ready = dsl_debug_now() - dslmngr_startup.start;
+	DSLMNGR_LOG(LOG_INFO, "UBUS objects published %" PRIu64 " us after start\n",
+			dslmngr_startup.ubus_ready);
+
+	// The metrics are optional, they are served in addition to the UBUS objects
+	if (dsl_metrics_init(dslmngr_conf.metrics_addr) != 0)
+		DSLMNGR_LOG(LOG_WARNING, "The metrics are not available\n");
+
+	// Probing the backend can take seconds, it is done off the main thread
+	probe.ctx = ctx;
+	probe.job.run = dsl_probe_run;
+	probe.job.done = dsl_probe_done;
+	probe.start = dsl_debug_now();
+	if (dsl_worker_spawn(&probe.job) != 0) {
+		dsl_probe_run(&probe.job);
+		dsl_probe_done(&probe.job);
+		if (probe.failed)
+			goto __ret;
+	}
 
 	uloop_run();
+	ret = probe.failed ? -1 : 0;
 
 __ret:
 	ubus_free(ctx);